@@ -0,0 +1,32 @@
+# Writes the shaders of a directory into a header as constexpr string views
+#
+# Run as a script at build time:
+#   cmake -DSHADER_DIR=<directory> -DOUTPUT=<header> -P EmbedShaders.cmake
+#
+# The header defines embedded_shaders, an array of {file name, source} sorted by name.
+# Sources are raw string literals, they must not contain the )glsl" delimiter.
+
+file(GLOB _shader_files RELATIVE "${SHADER_DIR}" "${SHADER_DIR}/*")
+list(SORT _shader_files)
+
+set(_content "// generated by cmake/EmbedShaders.cmake from ${SHADER_DIR}, do not edit\n")
+string(APPEND _content "#pragma once\n\n#include <string_view>\n\n")
+string(APPEND _content "struct EmbeddedShader {\n  std::string_view name;\n  std::string_view source;\n};\n\n")
+string(APPEND _content "constexpr EmbeddedShader embedded_shaders[] = {\n")
+foreach(_name ${_shader_files})
+	file(READ "${SHADER_DIR}/${_name}" _source)
+	string(FIND "${_source}" ")glsl\"" _delimiter)
+	if(NOT _delimiter EQUAL -1)
+		message(FATAL_ERROR "${_name} contains the )glsl\" delimiter of the embedded sources")
+	endif()
+	string(APPEND _content "    {\"${_name}\", R\"glsl(${_source})glsl\"},\n")
+endforeach()
+string(APPEND _content "};\n")
+
+# only touched when the shaders changed, sparing a rebuild of its includers
+if(EXISTS "${OUTPUT}")
+	file(READ "${OUTPUT}" _previous)
+endif()
+if(NOT "${_content}" STREQUAL "${_previous}")
+	file(WRITE "${OUTPUT}" "${_content}")
+endif()
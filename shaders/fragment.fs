@@ -1,6 +1,6 @@
 #version 330 core
 
-uniform vec4 is_alive;
+flat in vec4 color;
 out vec4 out_color;
 
-void main() { out_color = is_alive; }
\ No newline at end of file
+void main() { out_color = color; }
\ No newline at end of file
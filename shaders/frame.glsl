@@ -0,0 +1,19 @@
+// included by the renderers' shaders, DEAD_COLOR, ALIVE_COLOR and HOVERED_COLOR are defined by the renderer
+
+// changes every frame, shared by the renderers' programs
+layout(std140) uniform Frame {
+  // hovered cell, -1 for none
+  ivec2 hovered;
+  // camera of TextureRenderer: board pixel at the window center, pixels per cell and per square
+  vec2 origin;
+  float zoom;
+  float square;
+  // density level drawn instead of the cells and the side of its blocks, -1 for the cells
+  int level;
+  int block_side;
+};
+
+vec4 cell_color(ivec2 cell, bool alive) {
+  if (cell == hovered) return HOVERED_COLOR;
+  return alive ? ALIVE_COLOR : DEAD_COLOR;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#version 330 core
+
+// one texel per cell, 1 when alive
+// or when packed, one texel per 64 bit word of the board, low half in r and high half in g
+uniform usampler2D cells;
+// live cells of each block of the Frame level
+uniform usampler2D density;
+// BIT_PACKED, GRID_SIZE and WINDOW_SIZE are defined by TextureRenderer
+#include "frame.glsl"
+
+out vec4 out_color;
+
+void main() {
+  // pixels from the window center, y going down, then from the board corner
+  ivec2 pixel = ivec2(floor(gl_FragCoord.x - WINDOW_SIZE.x / 2), floor(WINDOW_SIZE.y / 2 - gl_FragCoord.y));
+  vec2 position = vec2(pixel) + origin;
+  ivec2 cell = ivec2(floor(position / zoom));
+  vec2 inside = position - vec2(cell) * zoom;
+
+  // gutters and margin are left as they are
+  if (inside.x >= square || inside.y >= square) discard;
+  if (cell.x < 0 || cell.y < 0 || cell.x >= GRID_SIZE.x || cell.y >= GRID_SIZE.y) discard;
+
+  if (level >= 0) {
+    float live = float(texelFetch(density, cell / block_side, 0).r) / float(block_side * block_side);
+    // square root for the sparse blocks of a typical board not to fade out
+    out_color = mix(DEAD_COLOR, ALIVE_COLOR, sqrt(live));
+    return;
+  }
+
+  bool alive;
+  if (BIT_PACKED) {
+    uvec2 word = texelFetch(cells, ivec2(cell.x / 64, cell.y), 0).rg;
+    int bit = cell.x % 64;
+    alive = (((bit < 32 ? word.r : word.g) >> uint(bit % 32)) & 1u) == 1u;
+  } else {
+    alive = texelFetch(cells, cell, 0).r == 1u;
+  }
+
+  out_color = cell_color(cell, alive);
+}
\ No newline at end of file
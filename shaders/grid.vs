@@ -0,0 +1,7 @@
+#version 330 core
+
+// full screen quad as a triangle strip, no vertex buffer needed
+void main() {
+  vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+  gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#version 330 core
+
+// current generation, one texel per cell, 1 when alive
+uniform usampler2D cells;
+// BIRTH and SURVIVAL are defined by FragmentLife, bit n set when n neighbors make a dead cell born or keep a live one
+
+out uint next;
+
+void main() {
+  ivec2 cell = ivec2(gl_FragCoord.xy);
+  ivec2 size = textureSize(cells, 0);
+
+  // cells outside of the board are dead
+  uint neighbors = 0u;
+  for (int dy = -1; dy <= 1; dy++) {
+    for (int dx = -1; dx <= 1; dx++) {
+      ivec2 neighbor = cell + ivec2(dx, dy);
+      if ((dx != 0 || dy != 0) && all(greaterThanEqual(neighbor, ivec2(0))) && all(lessThan(neighbor, size)))
+        neighbors += texelFetch(cells, neighbor, 0).r;
+    }
+  }
+
+  uint alive = texelFetch(cells, cell, 0).r;
+  next = ((alive == 1u ? SURVIVAL : BIRTH) >> neighbors) & 1u;
+}
\ No newline at end of file
@@ -2,6 +2,19 @@
 
 // the position variable has attribute position 0
 layout(location = 0) in vec3 pos;
-uniform vec2 offset;
+// state of the cell drawn by this instance, 1 when alive
+layout(location = 1) in uint state;
 
-void main() { gl_Position = vec4(pos.xy + offset.xy, pos.z, 1.0); }
\ No newline at end of file
+// GRID_SIZE, CELL_STEP and HALF_SQUARE are defined by InstancedRenderer
+#include "frame.glsl"
+
+flat out vec4 color;
+
+void main() {
+  // instances go through the grid row by row, the grid is centered in the window
+  ivec2 cell = ivec2(gl_InstanceID % GRID_SIZE.x, gl_InstanceID / GRID_SIZE.x);
+  ivec2 centered = cell - GRID_SIZE / 2;
+  vec2 offset = vec2(CELL_STEP.x * centered.x + HALF_SQUARE.x, -CELL_STEP.y * centered.y - HALF_SQUARE.y);
+  gl_Position = vec4(pos.xy + offset, pos.z, 1.0);
+  color = cell_color(cell, state == 1u);
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "batch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "soup.hpp"
+
+namespace {
+
+constexpr int max_lanes = 4;
+
+inline size_t cell_index(const BatchBoard &batch, int x, int y) {
+  return ((size_t)(y + 1) * (batch.width + 2) + (x + 1)) * batch.lanes;
+}
+
+// lanes is a constant so the inner loop unrolls into one vector operation per neighbor
+template <int Lanes>
+void step_batch(const uint64_t *src, uint64_t *dst, int width, int height) {
+  const size_t pitch = (size_t)(width + 2) * Lanes;
+  for (int y = 1; y <= height; y++) {
+    const uint64_t *row = src + y * pitch;
+    uint64_t *out = dst + y * pitch;
+    for (int x = 1; x <= width; x++) {
+      const uint64_t *above = row - pitch + x * Lanes;
+      const uint64_t *center = row + x * Lanes;
+      const uint64_t *below = row + pitch + x * Lanes;
+      for (int l = 0; l < Lanes; l++) {
+        out[x * Lanes + l] = life_rule(above[l - Lanes], above[l], above[l + Lanes], center[l - Lanes], center[l + Lanes],
+                                       below[l - Lanes], below[l], below[l + Lanes], center[l]);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+BatchBoard make_batch(int width, int height, int count) {
+  BatchBoard batch;
+  batch.width = width;
+  batch.height = height;
+  batch.count = count;
+  batch.lanes = 1;
+  while (batch.lanes * 64 < count && batch.lanes < max_lanes) batch.lanes *= 2;
+  batch.count = std::min(count, batch.lanes * 64);
+  const size_t size = (size_t)(width + 2) * (height + 2) * batch.lanes;
+  batch.cells.assign(size, 0);
+  batch.next.assign(size, 0);
+  return batch;
+}
+
+bool get_batch_cell(const BatchBoard &batch, int board, int x, int y) {
+  if (x < 0 || y < 0 || x >= batch.width || y >= batch.height) return false;
+  return (batch.cells[cell_index(batch, x, y) + board / 64] >> (board % 64)) & 1;
+}
+
+void set_batch_cell(BatchBoard &batch, int board, int x, int y, bool alive) {
+  if (x < 0 || y < 0 || x >= batch.width || y >= batch.height) return;
+  uint64_t &word = batch.cells[cell_index(batch, x, y) + board / 64];
+  if (alive)
+    word |= uint64_t(1) << (board % 64);
+  else
+    word &= ~(uint64_t(1) << (board % 64));
+}
+
+void load_board(BatchBoard &batch, int index, const Board &board) {
+  for (int y = 0; y < batch.height; y++)
+    for (int x = 0; x < batch.width; x++) set_batch_cell(batch, index, x, y, get_cell(board, x, y));
+}
+
+void store_board(const BatchBoard &batch, int index, Board &board) {
+  for (int y = 0; y < batch.height; y++)
+    for (int x = 0; x < batch.width; x++) set_cell(board, x, y, get_batch_cell(batch, index, x, y));
+}
+
+void update_batch(BatchBoard &batch) {
+  // the border of next is never written and stays dead
+  switch (batch.lanes) {
+    case 1:
+      step_batch<1>(batch.cells.data(), batch.next.data(), batch.width, batch.height);
+      break;
+    case 2:
+      step_batch<2>(batch.cells.data(), batch.next.data(), batch.width, batch.height);
+      break;
+    default:
+      step_batch<4>(batch.cells.data(), batch.next.data(), batch.width, batch.height);
+      break;
+  }
+  batch.cells.swap(batch.next);
+}
+
+int run_batch_benchmark(int count, int width, int height, int generations) {
+  std::vector<Board> boards;
+  for (int i = 0; i < count; i++) {
+    boards.push_back(make_board(width, height));
+    fill_soup(boards.back(), i, 0.5, 0, 0, width, height);
+  }
+  std::vector<BatchBoard> batches;
+  for (int first = 0; first < count; first += max_lanes * 64) {
+    batches.push_back(make_batch(width, height, std::min(count - first, max_lanes * 64)));
+    for (int i = 0; i < batches.back().count; i++) load_board(batches.back(), i, boards[first + i]);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (Board &board : boards)
+    for (int g = 0; g < generations; g++) update_cells(board);
+  const double sequential = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  start = std::chrono::steady_clock::now();
+  for (BatchBoard &batch : batches)
+    for (int g = 0; g < generations; g++) update_batch(batch);
+  const double batched = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  int mismatches = 0;
+  Board result = make_board(width, height);
+  for (int i = 0; i < count; i++) {
+    store_board(batches[i / (max_lanes * 64)], i % (max_lanes * 64), result);
+    if (result.cells != boards[i].cells) mismatches++;
+  }
+
+  std::cout << count << " boards of " << width << "x" << height << ", " << generations << " generations" << std::endl;
+  std::cout << "update_cells: " << count * (double)generations / sequential << " board generations/s" << std::endl;
+  std::cout << "batch:        " << count * (double)generations / batched << " board generations/s ("
+            << sequential / batched << "x)" << std::endl;
+  if (mismatches > 0) {
+    std::cout << "ERROR: " << mismatches << " boards differ between the two engines" << std::endl;
+    return 1;
+  }
+  return 0;
+}
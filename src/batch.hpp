@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "life.hpp"
+
+/**
+ * many boards of the same size stepped together, bit-sliced:
+ * each cell is `lanes` words and bit b of lane l is that cell on board l * 64 + b
+ * so one word operation steps the same cell of 64 boards (256 with 4 lanes, which vectorizes)
+ * rows and columns are padded with a dead border so the stepping loop has no bound checks
+ */
+struct BatchBoard {
+  int width = 0;
+  int height = 0;
+  int lanes = 0;
+  int count = 0;
+  std::vector<uint64_t> cells;
+  std::vector<uint64_t> next;
+};
+
+// `count` boards of width * height, lanes is rounded up to 1, 2 or 4 words
+BatchBoard make_batch(int width, int height, int count);
+
+bool get_batch_cell(const BatchBoard &batch, int board, int x, int y);
+void set_batch_cell(BatchBoard &batch, int board, int x, int y, bool alive);
+
+// copies a board in or out of the batch
+void load_board(BatchBoard &batch, int index, const Board &board);
+void store_board(const BatchBoard &batch, int index, Board &board);
+
+// advances every board of the batch by one generation
+void update_batch(BatchBoard &batch);
+
+/**
+ * steps `count` random boards of width * height for `generations`, once with update_cells
+ * board by board and once with the batch engine, checks they agree and prints boards per second
+ * returns 0 when they agree
+ */
+int run_batch_benchmark(int count, int width, int height, int generations);
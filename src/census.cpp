@@ -0,0 +1,354 @@
+#include "census.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "life.hpp"
+#include "soup.hpp"
+
+namespace {
+
+constexpr int soup_size = 16;
+constexpr int universe_size = 128;
+constexpr int max_period = 30;
+// generations the population has to repeat over before the soup counts as stable
+constexpr int stable_window = 120;
+constexpr int max_generations = 20000;
+// spaceships are caught in this band, at most 4 cells away from it between two checks
+constexpr int edge_band = 6;
+constexpr int edge_check_interval = 8;
+constexpr long long soups_per_grab = 64;
+
+using Tally = std::map<std::string, long long>;
+
+struct Cell {
+  int x, y;
+};
+
+using Cluster = std::vector<Cell>;
+
+std::vector<Cell> live_cells(const Board &board) {
+  std::vector<Cell> cells;
+  for (int y = 0; y < board.height; y++) {
+    for (int i = 0; i < board.stride; i++) {
+      uint64_t word = board.cells[(size_t)y * board.stride + i];
+      for (int bit = 0; word != 0; bit++, word >>= 1)
+        if (word & 1) cells.push_back({i * 64 + bit, y});
+    }
+  }
+  return cells;
+}
+
+// groups alive cells at most `reach` cells away from each other
+std::vector<Cluster> find_clusters(const Board &board, int reach) {
+  std::vector<Cluster> clusters;
+  std::vector<char> visited((size_t)board.width * board.height, 0);
+  for (const Cell &start : live_cells(board)) {
+    if (visited[(size_t)start.y * board.width + start.x]) continue;
+    visited[(size_t)start.y * board.width + start.x] = 1;
+    Cluster cluster = {start};
+    for (size_t i = 0; i < cluster.size(); i++) {
+      const Cell c = cluster[i];
+      for (int dy = -reach; dy <= reach; dy++) {
+        for (int dx = -reach; dx <= reach; dx++) {
+          const int x = c.x + dx, y = c.y + dy;
+          if (!get_cell(board, x, y) || visited[(size_t)y * board.width + x]) continue;
+          visited[(size_t)y * board.width + x] = 1;
+          cluster.push_back({x, y});
+        }
+      }
+    }
+    clusters.push_back(cluster);
+  }
+  return clusters;
+}
+
+// moves the cells so the bounding box starts at (0, 0) and sorts them
+Cluster normalize(Cluster cells, int *min_x = nullptr, int *min_y = nullptr) {
+  int left = cells[0].x, top = cells[0].y;
+  for (const Cell &c : cells) {
+    left = std::min(left, c.x);
+    top = std::min(top, c.y);
+  }
+  for (Cell &c : cells) {
+    c.x -= left;
+    c.y -= top;
+  }
+  std::sort(cells.begin(), cells.end(), [](Cell a, Cell b) { return a.y != b.y ? a.y < b.y : a.x < b.x; });
+  if (min_x) *min_x = left;
+  if (min_y) *min_y = top;
+  return cells;
+}
+
+bool same_cells(const Cluster &a, const Cluster &b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); i++)
+    if (a[i].x != b[i].x || a[i].y != b[i].y) return false;
+  return true;
+}
+
+/**
+ * extended wechsler format: strips of 5 rows, one character per column,
+ * strips separated by z, runs of empty columns shortened with w, x and y
+ */
+std::string wechsler(const Cluster &cells) {
+  static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+  int width = 0, height = 0;
+  for (const Cell &c : cells) {
+    width = std::max(width, c.x + 1);
+    height = std::max(height, c.y + 1);
+  }
+  const int strips = (height + 4) / 5;
+  std::vector<int> columns((size_t)strips * width, 0);
+  for (const Cell &c : cells) columns[(size_t)(c.y / 5) * width + c.x] |= 1 << (c.y % 5);
+
+  std::string code;
+  for (int s = 0; s < strips; s++) {
+    if (s > 0) code += 'z';
+    int last = width;
+    while (last > 0 && columns[(size_t)s * width + last - 1] == 0) last--;
+    for (int x = 0; x < last;) {
+      int zeros = 0;
+      while (x + zeros < last && columns[(size_t)s * width + x + zeros] == 0) zeros++;
+      if (zeros == 0) {
+        code += digits[columns[(size_t)s * width + x]];
+        x++;
+        continue;
+      }
+      x += zeros;
+      while (zeros > 0) {
+        if (zeros >= 4) {
+          const int run = std::min(zeros, 39);
+          code += 'y';
+          code += digits[run - 4];
+          zeros -= run;
+        } else {
+          code += zeros == 3 ? "x" : zeros == 2 ? "w" : "0";
+          zeros = 0;
+        }
+      }
+    }
+  }
+  return code;
+}
+
+// shortest then alphabetically first code over the 8 orientations
+std::string canonical_code(const Cluster &cells) {
+  std::string best;
+  for (int orientation = 0; orientation < 8; orientation++) {
+    Cluster transformed = cells;
+    for (Cell &c : transformed) {
+      int x = (orientation & 1) ? -c.x : c.x;
+      int y = (orientation & 2) ? -c.y : c.y;
+      if (orientation & 4) std::swap(x, y);
+      c = {x, y};
+    }
+    const std::string code = wechsler(normalize(transformed));
+    if (best.empty() || code.size() < best.size() || (code.size() == best.size() && code < best)) best = code;
+  }
+  return best;
+}
+
+/**
+ * runs the cluster on its own until it comes back to its first phase
+ * returns its apgcode, or an empty string when it's not a still life, an oscillator or a spaceship
+ */
+std::string classify(const Cluster &cluster) {
+  int left, top;
+  const Cluster start = normalize(cluster, &left, &top);
+  int width = 0, height = 0;
+  for (const Cell &c : start) {
+    width = std::max(width, c.x + 1);
+    height = std::max(height, c.y + 1);
+  }
+  // room for oscillators to grow and spaceships to move (at most c/2)
+  const int margin = max_period / 2 + 4;
+  Board board = make_board(width + 2 * margin, height + 2 * margin);
+  for (const Cell &c : start) set_cell(board, c.x + margin, c.y + margin, true);
+
+  std::vector<Cluster> phases = {start};
+  for (int period = 1; period <= max_period; period++) {
+    update_cells(board);
+    const std::vector<Cell> cells = live_cells(board);
+    if (cells.empty()) return "";
+    for (const Cell &c : cells)
+      if (c.x == 0 || c.y == 0 || c.x == board.width - 1 || c.y == board.height - 1) return "";
+
+    int phase_left, phase_top;
+    const Cluster phase = normalize(cells, &phase_left, &phase_top);
+    if (!same_cells(phase, start)) {
+      phases.push_back(phase);
+      continue;
+    }
+
+    std::string best;
+    for (const Cluster &p : phases) {
+      const std::string code = canonical_code(p);
+      if (best.empty() || code.size() < best.size() || (code.size() == best.size() && code < best)) best = code;
+    }
+    const bool moved = phase_left != margin || phase_top != margin;
+    if (moved) return "xq" + std::to_string(period) + "_" + best;
+    if (period == 1) return "xs" + std::to_string(start.size()) + "_" + best;
+    return "xp" + std::to_string(period) + "_" + best;
+  }
+  return "";
+}
+
+bool near_edge(const Cell &c) {
+  return c.x < edge_band || c.y < edge_band || c.x >= universe_size - edge_band || c.y >= universe_size - edge_band;
+}
+
+// counts and removes spaceships about to leave the universe, returns true if any was removed
+bool remove_escapees(Board &board, Tally &tally) {
+  bool any_near_edge = false;
+  for (int y = 0; y < board.height && !any_near_edge; y++) {
+    const uint64_t *row = board.cells.data() + (size_t)y * board.stride;
+    if (y < edge_band || y >= board.height - edge_band) {
+      for (int i = 0; i < board.stride; i++) any_near_edge |= row[i] != 0;
+    } else {
+      // first and last edge_band columns
+      any_near_edge = (row[0] & ((uint64_t(1) << edge_band) - 1)) != 0 ||
+                      (row[board.stride - 1] >> ((board.width - 1) % 64 + 1 - edge_band)) != 0;
+    }
+  }
+  if (!any_near_edge) return false;
+
+  bool removed = false;
+  for (const Cluster &cluster : find_clusters(board, 1)) {
+    if (std::none_of(cluster.begin(), cluster.end(), near_edge)) continue;
+    const std::string code = classify(cluster);
+    if (code.compare(0, 2, "xq") != 0) continue;
+    tally[code]++;
+    for (const Cell &c : cluster) set_cell(board, c.x, c.y, false);
+    removed = true;
+  }
+  return removed;
+}
+
+bool population_periodic(const std::vector<long long> &history) {
+  const size_t n = history.size();
+  if (n < (size_t)(stable_window + max_period)) return false;
+  for (int period = 1; period <= max_period; period++) {
+    bool periodic = true;
+    for (size_t i = 1; i <= (size_t)stable_window && periodic; i++)
+      periodic = history[n - i] == history[n - i - period];
+    if (periodic) return true;
+  }
+  return false;
+}
+
+/**
+ * tallies connected objects, then retries what's left grouped a bit more loosely
+ * to put back together objects whose phases are disconnected (and pairs too close to be apart)
+ */
+void take_census(const Board &board, Tally &tally) {
+  Board leftovers = make_board(board.width, board.height);
+  bool any_leftover = false;
+  for (const Cluster &cluster : find_clusters(board, 1)) {
+    const std::string code = classify(cluster);
+    if (!code.empty()) {
+      tally[code]++;
+      continue;
+    }
+    for (const Cell &c : cluster) set_cell(leftovers, c.x, c.y, true);
+    any_leftover = true;
+  }
+  if (!any_leftover) return;
+  for (const Cluster &cluster : find_clusters(leftovers, 2)) {
+    const std::string code = classify(cluster);
+    tally[code.empty() ? "zz_unknown" : code]++;
+  }
+}
+
+void run_soup(Board &board, uint64_t seed, double density, Tally &tally) {
+  clear_board(board);
+  const int corner = (universe_size - soup_size) / 2;
+  fill_soup(board, seed, density, corner, corner, soup_size, soup_size);
+
+  // the population is the cheap stabilization test, objects are only looked at once it repeats
+  std::vector<long long> history;
+  for (int generation = 0; generation < max_generations; generation++) {
+    if (generation % edge_check_interval == 0 && remove_escapees(board, tally)) history.clear();
+    history.push_back(population(board));
+    if (generation % 10 == 0 && population_periodic(history)) {
+      take_census(board, tally);
+      return;
+    }
+    update_cells(board);
+  }
+  tally["zz_unstable"]++;
+}
+
+}  // namespace
+
+int run_census(const CensusOptions &options) {
+  int threads = options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+  std::cout << "census of " << options.soups << " soups, seed " << options.seed << ", " << threads << " threads"
+            << std::endl;
+
+  const auto start = std::chrono::steady_clock::now();
+  std::atomic<long long> next_soup(0);
+  std::atomic<long long> done(0);
+  std::vector<Tally> tallies(threads);
+  // signaled by the worker finishing the last grab
+  std::mutex mutex;
+  std::condition_variable finished;
+
+  // soups are handed out in small grabs so slow ones don't leave a thread behind
+  auto worker = [&](int t) {
+    Board board = make_board(universe_size, universe_size);
+    for (;;) {
+      const long long begin = next_soup.fetch_add(soups_per_grab);
+      if (begin >= options.soups) return;
+      const long long end = std::min(begin + soups_per_grab, options.soups);
+      for (long long soup = begin; soup < end; soup++)
+        run_soup(board, splitmix64(options.seed + soup), options.density, tallies[t]);
+      if ((done += end - begin) >= options.soups) {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.notify_one();
+      }
+    }
+  };
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) workers.emplace_back(worker, t);
+
+  // progress every second, woken right away by the end so the time measured doesn't include the rest of the wait
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!finished.wait_for(lock, std::chrono::seconds(1), [&] { return done >= options.soups; })) {
+      const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::cout << done << " soups, " << (long long)(done / elapsed) << " soups/s" << std::endl;
+    }
+  }
+  for (auto &w : workers) w.join();
+  const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  Tally total;
+  for (const Tally &tally : tallies)
+    for (const auto &entry : tally) total[entry.first] += entry.second;
+  std::vector<std::pair<std::string, long long>> sorted(total.begin(), total.end());
+  std::stable_sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+
+  std::ofstream file(options.output);
+  if (!file) {
+    std::cout << "ERROR while writing " << options.output << std::endl;
+    return 1;
+  }
+  file << "# " << options.soups << " soups " << soup_size << "x" << soup_size << " at density " << options.density
+       << ", seed " << options.seed << "\n";
+  file << "# " << elapsed << " s, " << (long long)(options.soups / elapsed) << " soups/s\n";
+  for (const auto &entry : sorted) file << entry.first << " " << entry.second << "\n";
+
+  std::cout << options.soups << " soups in " << elapsed << " s, " << (long long)(options.soups / elapsed)
+            << " soups/s, census written to " << options.output << std::endl;
+  return 0;
+}
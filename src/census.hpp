@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * headless soup search, apgsearch style
+ * random 16x16 soups are run until their population becomes periodic,
+ * then split into objects which are tallied by their apgcode (xs4_33 for a block, xq4_153 for a glider, ...)
+ * spaceships reaching the edge of the universe are counted and removed before they crash into it
+ */
+struct CensusOptions {
+  long long soups = 1000000;
+  uint64_t seed = 0;
+  double density = 0.5;
+  // 0 = one per core
+  int threads = 0;
+  const char *output = "census.txt";
+};
+
+// returns 0 on success, 1 if the census file could not be written
+int run_census(const CensusOptions &options);
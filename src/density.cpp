@@ -0,0 +1,74 @@
+#include "density.hpp"
+
+#include <algorithm>
+
+namespace {
+
+static_assert(tile_rows == 8, "a tile row is a row of 8x8 blocks");
+
+// live cells in each byte of the word, a byte being 8 cells of a row of 8x8 blocks
+uint64_t byte_popcounts(uint64_t x) {
+  x = x - ((x >> 1) & 0x5555555555555555);
+  x = (x & 0x3333333333333333) + ((x >> 2) & 0x3333333333333333);
+  return (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0f;
+}
+
+}  // namespace
+
+DensityPyramid::DensityPyramid(const Board &board) {
+  for (int level = 0; level < levels; level++) {
+    columns_[level] = (board.width + block_side(level) - 1) / block_side(level);
+    rows_[level] = (board.height + block_side(level) - 1) / block_side(level);
+    counts_[level].assign((size_t)columns_[level] * rows_[level], 0);
+    dirty_[level].assign(rows_[level], 0);
+  }
+  for (int y = 0; y < rows_[0]; y++)
+    for (int x = 0; x < board.stride; x++) count_tile(board, x, y);
+  for (int level = 0; level < levels; level++) std::fill(dirty_[level].begin(), dirty_[level].end(), 1);
+}
+
+void DensityPyramid::update(const Board &board) {
+  for (int y = 0; y < rows_[0]; y++) {
+    const unsigned char *tiles = board.tiles.data() + (size_t)y * board.stride;
+    for (int x = 0; x < board.stride; x++)
+      if (tiles[x]) count_tile(board, x, y);
+  }
+}
+
+void DensityPyramid::count_tile(const Board &board, int x, int y) {
+  // at most 64 per byte, no carry into the next one
+  uint64_t sums = 0;
+  const int row_end = std::min(board.height, (y + 1) * tile_rows);
+  for (int row = y * tile_rows; row < row_end; row++)
+    sums += byte_popcounts(board.cells[(size_t)row * board.stride + x]);
+
+  uint32_t *counts = counts_[0].data() + (size_t)y * columns_[0];
+  int delta = 0;
+  bool changed = false;
+  for (int b = 0; b < 8 && x * 8 + b < columns_[0]; b++) {
+    const uint32_t count = (sums >> (8 * b)) & 0xff;
+    const uint32_t previous = counts[x * 8 + b];
+    occupied_[0] += (count != 0) - (previous != 0);
+    delta += (int)count - (int)previous;
+    changed |= count != previous;
+    counts[x * 8 + b] = count;
+  }
+  if (changed) dirty_[0][y] = 1;
+  // the 8 blocks of the tile share their block on every level above
+  if (delta != 0) add(1, x, y / 8, delta);
+}
+
+void DensityPyramid::add(int level, int column, int row, int delta) {
+  population_ += delta;
+  for (; level < levels; level++, column /= 8, row /= 8) {
+    uint32_t &count = counts_[level][(size_t)row * columns_[level] + column];
+    const uint32_t updated = count + delta;
+    occupied_[level] += (updated != 0) - (count != 0);
+    count = updated;
+    dirty_[level][row] = 1;
+  }
+}
+
+void DensityPyramid::mark_clean() {
+  for (int level = 0; level < levels; level++) std::fill(dirty_[level].begin(), dirty_[level].end(), 0);
+}
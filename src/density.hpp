@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "life.hpp"
+
+/**
+ * live cells per block of the board for 8x8, 64x64 and 512x512 blocks, each level summing 8x8 blocks
+ * of the previous one, to draw views where a pixel covers many cells
+ * kept up to date from the tiles the board flags as changed, a tile being 8 blocks of the first level, whose
+ * count changes are added to the blocks above them, instead of counting the whole board again
+ * blocks on the right and bottom edges can reach past the board
+ */
+class DensityPyramid {
+ public:
+  static constexpr int levels = 3;
+
+  explicit DensityPyramid(const Board &board);
+
+  // side in cells of the blocks of a level
+  static int block_side(int level) { return 8 << (3 * level); }
+  int columns(int level) const { return columns_[level]; }
+  int rows(int level) const { return rows_[level]; }
+  // live cells of each block of a level, row after row
+  const std::vector<uint32_t> &counts(int level) const { return counts_[level]; }
+
+  // counts again the tiles flagged in board.tiles, to call before mark_clean(board)
+  void update(const Board &board);
+  // one flag per row of blocks of a level, set when one of its counts changed since the last mark_clean
+  const std::vector<unsigned char> &dirty(int level) const { return dirty_[level]; }
+  void mark_clean();
+
+  // live cells of the board as of the last update
+  long long population() const { return population_; }
+  // blocks of a level with at least one live cell
+  long long occupied(int level) const { return occupied_[level]; }
+
+ private:
+  void count_tile(const Board &board, int x, int y);
+  // adds delta to the block of level at (column, row) and to the blocks containing it
+  void add(int level, int column, int row, int delta);
+
+  int columns_[levels], rows_[levels];
+  std::vector<uint32_t> counts_[levels];
+  std::vector<unsigned char> dirty_[levels];
+  long long population_ = 0;
+  long long occupied_[levels] = {};
+};
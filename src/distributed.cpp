@@ -0,0 +1,298 @@
+#include "distributed.hpp"
+
+#include <iostream>
+
+#ifdef _WIN32
+
+int run_distributed(const DistributedOptions &options) {
+  std::cout << "ERROR distributed mode needs fork and unix sockets, not available on windows" << std::endl;
+  return 1;
+}
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <utility>
+
+#include "life.hpp"
+#include "soup.hpp"
+
+struct Communicator::Transfer {
+  // sent before each message so the receiver can check it matches what it expects
+  struct Header {
+    int64_t tag;
+    uint64_t bytes;
+  };
+  Header header;
+  // what was actually received, compared with header once complete
+  Header received;
+  char *data;
+  size_t bytes;
+  // counts the header then the data
+  size_t done = 0;
+  bool complete = false;
+};
+
+Communicator::Communicator(int rank, std::vector<int> peers)
+    : rank_(rank), peers_(std::move(peers)), sends_(peers_.size()), recvs_(peers_.size()) {
+  for (int fd : peers_)
+    if (fd >= 0) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+Communicator::~Communicator() {
+  for (int fd : peers_)
+    if (fd >= 0) close(fd);
+}
+
+Communicator::Request Communicator::isend(const void *data, size_t bytes, int dest, int tag) {
+  Request request = std::make_shared<Transfer>();
+  request->header = {tag, bytes};
+  request->data = (char *)data;
+  request->bytes = bytes;
+  sends_[dest].push_back(request);
+  progress(false);
+  return request;
+}
+
+Communicator::Request Communicator::irecv(void *data, size_t bytes, int source, int tag) {
+  Request request = std::make_shared<Transfer>();
+  request->header = {tag, bytes};
+  request->data = (char *)data;
+  request->bytes = bytes;
+  recvs_[source].push_back(request);
+  progress(false);
+  return request;
+}
+
+void Communicator::wait_all(const std::vector<Request> &requests) {
+  while (std::any_of(requests.begin(), requests.end(), [](const Request &r) { return !r->complete; })) progress(true);
+}
+
+void Communicator::progress(bool block) {
+  std::vector<pollfd> fds;
+  for (int peer = 0; peer < size(); peer++) {
+    short events = (sends_[peer].empty() ? 0 : POLLOUT) | (recvs_[peer].empty() ? 0 : POLLIN);
+    if (events != 0) fds.push_back({peers_[peer], events, 0});
+  }
+  if (fds.empty()) return;
+  if (poll(fds.data(), fds.size(), block ? -1 : 0) < 0 && errno != EINTR) {
+    std::cout << "ERROR rank " << rank_ << " poll failed" << std::endl;
+    exit(1);
+  }
+
+  for (const pollfd &fd : fds) {
+    const int peer = (int)(std::find(peers_.begin(), peers_.end(), fd.fd) - peers_.begin());
+    if (fd.revents & (POLLERR | POLLHUP | POLLNVAL) && !(fd.revents & POLLIN)) {
+      std::cout << "ERROR rank " << rank_ << " lost rank " << peer << std::endl;
+      exit(1);
+    }
+
+    // send as much as the socket takes, transfer after transfer
+    while ((fd.revents & POLLOUT) && !sends_[peer].empty()) {
+      Transfer &t = *sends_[peer].front();
+      const bool in_header = t.done < sizeof(t.header);
+      const char *from = in_header ? (const char *)&t.header + t.done : t.data + (t.done - sizeof(t.header));
+      const size_t left = in_header ? sizeof(t.header) - t.done : t.bytes - (t.done - sizeof(t.header));
+      const ssize_t written = left == 0 ? 0 : send(fd.fd, from, left, MSG_NOSIGNAL);
+      if (written < 0) break;
+      t.done += written;
+      if (t.done == sizeof(t.header) + t.bytes) {
+        t.complete = true;
+        sends_[peer].pop_front();
+      } else if ((size_t)written < left) {
+        break;
+      }
+    }
+
+    while ((fd.revents & (POLLIN | POLLHUP)) && !recvs_[peer].empty()) {
+      Transfer &t = *recvs_[peer].front();
+      const bool in_header = t.done < sizeof(t.received);
+      char *to = in_header ? (char *)&t.received + t.done : t.data + (t.done - sizeof(t.received));
+      const size_t left = in_header ? sizeof(t.received) - t.done : t.bytes - (t.done - sizeof(t.received));
+      const ssize_t count = left == 0 ? 0 : recv(fd.fd, to, left, 0);
+      if (count < 0) break;
+      if (count == 0 && left > 0) {
+        std::cout << "ERROR rank " << rank_ << " lost rank " << peer << std::endl;
+        exit(1);
+      }
+      t.done += count;
+      if (in_header && t.done == sizeof(t.received) &&
+          (t.received.tag != t.header.tag || t.received.bytes != t.header.bytes)) {
+        std::cout << "ERROR rank " << rank_ << " expected tag " << t.header.tag << " from rank " << peer
+                  << " but got tag " << t.received.tag << std::endl;
+        exit(1);
+      }
+      if (t.done == sizeof(t.received) + t.bytes) {
+        t.complete = true;
+        recvs_[peer].pop_front();
+      } else if ((size_t)count < left) {
+        break;
+      }
+    }
+  }
+}
+
+namespace {
+
+struct Band {
+  int first_row;
+  int rows;
+  int stride;
+  // rows + 2 rows, the first and last one being the halos from the neighbors
+  std::vector<uint64_t> cells;
+  std::vector<uint64_t> next;
+};
+
+// halo rows are tagged with their generation, other messages use negative tags
+constexpr int tag_population = -1;
+constexpr int tag_gather = -2;
+
+int run_worker(Communicator &comm, const DistributedOptions &options) {
+  const int rank = comm.rank();
+  const int size = comm.size();
+  Band band;
+  band.first_row = (int)((long long)options.height * rank / size);
+  band.rows = (int)((long long)options.height * (rank + 1) / size) - band.first_row;
+  band.stride = (options.width + 63) / 64;
+  band.cells.assign((size_t)(band.rows + 2) * band.stride, 0);
+  band.next.assign(band.cells.size(), 0);
+
+  // same words fill_random would put there on a single board
+  const uint64_t mask = last_word_mask(options.width);
+  for (int r = 0; r < band.rows; r++) {
+    uint64_t *row = band.cells.data() + (size_t)(r + 1) * band.stride;
+    for (int i = 0; i < band.stride; i++)
+      row[i] = soup_word(options.seed, options.density, band.first_row + r, i);
+    row[band.stride - 1] &= mask;
+  }
+
+  const size_t row_bytes = band.stride * sizeof(uint64_t);
+  const int height = band.rows + 2;
+  for (int generation = 0; generation < options.generations; generation++) {
+    uint64_t *cells = band.cells.data();
+    std::vector<Communicator::Request> requests;
+    if (rank > 0) {
+      requests.push_back(comm.irecv(cells, row_bytes, rank - 1, generation));
+      requests.push_back(comm.isend(cells + band.stride, row_bytes, rank - 1, generation));
+    }
+    if (rank < size - 1) {
+      requests.push_back(comm.irecv(cells + (size_t)(band.rows + 1) * band.stride, row_bytes, rank + 1, generation));
+      requests.push_back(comm.isend(cells + (size_t)band.rows * band.stride, row_bytes, rank + 1, generation));
+    }
+
+    // rows away from the halos while they are on their way
+    step_rows(cells, band.next.data(), options.width, height, band.stride, 2, band.rows);
+    comm.wait_all(requests);
+    step_rows(cells, band.next.data(), options.width, height, band.stride, 1, 2);
+    if (band.rows > 1) step_rows(cells, band.next.data(), options.width, height, band.stride, band.rows, band.rows + 1);
+    band.cells.swap(band.next);
+  }
+
+  long long population = 0;
+  for (size_t i = band.stride; i < (size_t)(band.rows + 1) * band.stride; i++) population += popcount64(band.cells[i]);
+
+  if (rank > 0) {
+    std::vector<Communicator::Request> requests = {
+        comm.isend(&population, sizeof(population), 0, tag_population)};
+    if (options.verify)
+      requests.push_back(comm.isend(band.cells.data() + band.stride, band.rows * row_bytes, 0, tag_gather));
+    comm.wait_all(requests);
+    return 0;
+  }
+
+  long long total = population;
+  for (int r = 1; r < size; r++) {
+    long long count;
+    comm.wait_all({comm.irecv(&count, sizeof(count), r, tag_population)});
+    total += count;
+  }
+  std::cout << "population after " << options.generations << " generations: " << total << std::endl;
+  if (!options.verify) return 0;
+
+  Board gathered = make_board(options.width, options.height);
+  std::copy(band.cells.begin() + band.stride, band.cells.begin() + (band.rows + 1) * band.stride,
+            gathered.cells.begin());
+  for (int r = 1; r < size; r++) {
+    const int first = (int)((long long)options.height * r / size);
+    const int rows = (int)((long long)options.height * (r + 1) / size) - first;
+    comm.wait_all({comm.irecv(gathered.cells.data() + (size_t)first * band.stride, rows * row_bytes, r, tag_gather)});
+  }
+
+  Board reference = make_board(options.width, options.height);
+  fill_random(reference, options.seed, options.density, 1);
+  for (int g = 0; g < options.generations; g++) update_cells(reference);
+  if (reference.cells != gathered.cells) {
+    std::cout << "ERROR " << size << " workers disagree with update_cells" << std::endl;
+    return 1;
+  }
+  std::cout << size << " workers match update_cells" << std::endl;
+  return 0;
+}
+
+}  // namespace
+
+int run_distributed(const DistributedOptions &options) {
+  const int size = std::max(1, std::min(options.workers, options.height));
+  // every pair of workers gets a socket, most only ever talk to their neighbors
+  std::vector<std::vector<int>> peers(size, std::vector<int>(size, -1));
+  for (int a = 0; a < size; a++) {
+    for (int b = a + 1; b < size; b++) {
+      int pair[2];
+      if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+        std::cout << "ERROR could not create sockets between workers" << std::endl;
+        return 1;
+      }
+      peers[a][b] = pair[0];
+      peers[b][a] = pair[1];
+    }
+  }
+
+  std::cout << size << " workers, " << options.width << "x" << options.height << " board, " << options.generations
+            << " generations" << std::endl;
+  const auto start = std::chrono::steady_clock::now();
+
+  std::vector<pid_t> children;
+  for (int rank = 1; rank < size; rank++) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+      // keep only our own sockets
+      for (int r = 0; r < size; r++)
+        if (r != rank)
+          for (int fd : peers[r])
+            if (fd >= 0) close(fd);
+      Communicator comm(rank, peers[rank]);
+      _exit(run_worker(comm, options));
+    }
+    children.push_back(pid);
+  }
+  for (int r = 1; r < size; r++)
+    for (int fd : peers[r])
+      if (fd >= 0) close(fd);
+
+  int result;
+  {
+    Communicator comm(0, peers[0]);
+    result = run_worker(comm, options);
+  }
+  for (pid_t child : children) {
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) result = 1;
+  }
+
+  const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << elapsed << " s, " << options.generations / elapsed << " generations/s, "
+            << (double)options.width * options.height * options.generations / elapsed << " cells/s" << std::endl;
+  return result;
+}
+
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+/**
+ * point to point messages between local worker processes over unix sockets
+ * calls mirror MPI_Isend / MPI_Irecv / MPI_Waitall so the workers can run on MPI instead:
+ * buffers must stay untouched until their request completes,
+ * messages between two ranks arrive in order and are matched by tag and size
+ * there is no background progress, transfers advance during isend, irecv and wait_all
+ */
+class Communicator {
+ public:
+  struct Transfer;
+  using Request = std::shared_ptr<Transfer>;
+
+  // takes ownership of the sockets, peers[r] is connected to rank r (unused for our own rank)
+  Communicator(int rank, std::vector<int> peers);
+  ~Communicator();
+  Communicator(const Communicator &) = delete;
+  Communicator &operator=(const Communicator &) = delete;
+
+  int rank() const { return rank_; }
+  int size() const { return (int)peers_.size(); }
+
+  Request isend(const void *data, size_t bytes, int dest, int tag);
+  Request irecv(void *data, size_t bytes, int source, int tag);
+  void wait_all(const std::vector<Request> &requests);
+
+ private:
+  // moves every pending transfer forward, blocks until at least one socket is ready
+  void progress(bool block);
+
+  int rank_;
+  std::vector<int> peers_;
+  std::vector<std::deque<Request>> sends_;
+  std::vector<std::deque<Request>> recvs_;
+};
+
+struct DistributedOptions {
+  int workers = 4;
+  int width = 4096;
+  int height = 4096;
+  int generations = 100;
+  uint64_t seed = 0;
+  double density = 0.35;
+  // gathers the board on rank 0 and compares it with update_cells on a single board
+  bool verify = false;
+};
+
+/**
+ * splits the board in bands of rows, one per worker process, each only holding its band and two halo rows
+ * every generation the edge rows are sent to the neighbors while the interior rows are computed
+ * returns 0 on success, 1 if a worker failed or the verification found a difference
+ */
+int run_distributed(const DistributedOptions &options);
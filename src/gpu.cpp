@@ -0,0 +1,237 @@
+#include "gpu.hpp"
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "soup.hpp"
+
+namespace {
+
+// B3/S23 as masks of neighbor counts, the rule of life_rule
+constexpr unsigned int birth = 1 << 3;
+constexpr unsigned int survival = 1 << 2 | 1 << 3;
+
+}  // namespace
+
+ProgramSpec FragmentLife::program() {
+  return {{"grid.vs", "step.fs"},
+          {{"BIRTH", std::to_string(birth) + "u"}, {"SURVIVAL", std::to_string(survival) + "u"}}};
+}
+
+FragmentLife::FragmentLife(int width, int height) : width_(width), height_(height), program_(program()) {
+  glGenVertexArrays(1, &vao_);
+  glGenTextures(2, textures_);
+  glGenFramebuffers(2, framebuffers_);
+  for (int i = 0; i < 2; i++) {
+    glBindTexture(GL_TEXTURE_2D, textures_[i]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, width, height, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, NULL);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers_[i]);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures_[i], 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+      std::cout << "ERROR cell framebuffer " << i << " is incomplete" << std::endl;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  if (!program_.valid()) {
+    std::cout << "Error while parsing/compiling shaders" << std::endl;
+    return;
+  }
+  setup_program();
+}
+
+void FragmentLife::setup_program() {
+  program_.use();
+  program_.set("cells", 0);
+}
+
+void FragmentLife::reload_shaders(const std::vector<std::string> &changed) {
+  if (program_.reload(changed)) setup_program();
+}
+
+FragmentLife::~FragmentLife() {
+  glDeleteVertexArrays(1, &vao_);
+  glDeleteFramebuffers(2, framebuffers_);
+  glDeleteTextures(2, textures_);
+}
+
+void FragmentLife::upload(const Board &board) {
+  std::vector<unsigned char> states((size_t)width_ * height_);
+  for (int y = 0; y < height_; y++)
+    for (int x = 0; x < width_; x++) states[(size_t)y * width_ + x] = get_cell(board, x, y);
+  glBindTexture(GL_TEXTURE_2D, textures_[current_]);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, GL_RED_INTEGER, GL_UNSIGNED_BYTE, states.data());
+}
+
+void FragmentLife::download(Board &board) {
+  std::vector<unsigned char> states((size_t)width_ * height_);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers_[current_]);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width_, height_, GL_RED_INTEGER, GL_UNSIGNED_BYTE, states.data());
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+  clear_board(board);
+  for (int y = 0; y < height_; y++)
+    for (int x = 0; x < width_; x++)
+      if (states[(size_t)y * width_ + x]) board.cells[(size_t)y * board.stride + x / 64] |= uint64_t(1) << (x % 64);
+}
+
+void FragmentLife::step(int generations) {
+  GLint viewport[4], framebuffer;
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+  glViewport(0, 0, width_, height_);
+  program_.use();
+  glBindVertexArray(vao_);
+  glActiveTexture(GL_TEXTURE0);
+  for (int g = 0; g < generations; g++) {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers_[1 - current_]);
+    glBindTexture(GL_TEXTURE_2D, textures_[current_]);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    current_ = 1 - current_;
+  }
+  glBindVertexArray(0);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+bool compute_supported() { return GLAD_GL_VERSION_4_3 != 0; }
+
+ProgramSpec ComputeLife::program() { return {{"step.comp"}, {}}; }
+
+ComputeLife::ComputeLife(int width, int height)
+    : width_(width), height_(height), stride_((width + 63) / 64), program_(program()) {
+  const size_t bytes = (size_t)stride_ * height * sizeof(uint64_t);
+  glGenBuffers(2, buffers_);
+  for (int i = 0; i < 2; i++) {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers_[i]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, NULL, GL_DYNAMIC_COPY);
+  }
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+  glGenTextures(1, &texture_);
+  glBindTexture(GL_TEXTURE_2D, texture_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32UI, stride_, height, 0, GL_RG_INTEGER, GL_UNSIGNED_INT, NULL);
+
+  if (!program_.valid()) {
+    std::cout << "Error while parsing/compiling shaders" << std::endl;
+    return;
+  }
+  setup_program();
+}
+
+void ComputeLife::setup_program() {
+  program_.use();
+  program_.set("width", width_);
+  program_.set("height", height_);
+  program_.set("words", stride_ * 2);
+}
+
+void ComputeLife::reload_shaders(const std::vector<std::string> &changed) {
+  if (program_.reload(changed)) setup_program();
+}
+
+ComputeLife::~ComputeLife() {
+  glDeleteBuffers(2, buffers_);
+  glDeleteTextures(1, &texture_);
+}
+
+void ComputeLife::upload(const Board &board) {
+  // the 64 bit words of a little endian host are already 32 bit words in order
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers_[current_]);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, board.cells.size() * sizeof(uint64_t), board.cells.data());
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  texture_stale_ = true;
+}
+
+void ComputeLife::download(Board &board) {
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers_[current_]);
+  glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, board.cells.size() * sizeof(uint64_t), board.cells.data());
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  mark_rows_changed(board, 0, board.height);
+}
+
+void ComputeLife::step(int generations) {
+  program_.use();
+  for (int g = 0; g < generations; g++) {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffers_[current_]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, buffers_[1 - current_]);
+    glDispatchCompute((stride_ * 2 + 15) / 16, (height_ + 15) / 16, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    current_ = 1 - current_;
+  }
+  texture_stale_ = true;
+}
+
+unsigned int ComputeLife::texture() {
+  if (texture_stale_) {
+    glMemoryBarrier(GL_PIXEL_BUFFER_BARRIER_BIT);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers_[current_]);
+    glBindTexture(GL_TEXTURE_2D, texture_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, stride_, height_, GL_RG_INTEGER, GL_UNSIGNED_INT, (void *)0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    texture_stale_ = false;
+  }
+  return texture_;
+}
+
+namespace {
+
+// steps the gpu engine alongside the cpu board it started from, 0 when they end up the same
+int check_engine(const char *name, GpuLife &gpu, const Board &start, const Board &expected, int generations) {
+  gpu.upload(start);
+  const auto begin = std::chrono::steady_clock::now();
+  gpu.step(generations);
+  glFinish();
+  const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+  Board result = make_board(start.width, start.height);
+  gpu.download(result);
+  std::cout << name << ": " << (double)start.width * start.height * generations / elapsed << " cells/s";
+  if (result.cells != expected.cells) {
+    std::cout << std::endl << "ERROR " << name << " and cpu boards differ" << std::endl;
+    return 1;
+  }
+  std::cout << ", matches the cpu" << std::endl;
+  return 0;
+}
+
+}  // namespace
+
+int run_gpu_check(int width, int height, int generations, uint64_t seed, double density) {
+  std::cout << width << "x" << height << " board, " << generations << " generations" << std::endl;
+  GLint max_size = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+  if (width > max_size || height > max_size) {
+    std::cout << "ERROR board larger than the " << max_size << " texels textures can have" << std::endl;
+    return 1;
+  }
+
+  Board start = make_board(width, height);
+  fill_random(start, seed, density);
+  Board board = start;
+  const auto begin = std::chrono::steady_clock::now();
+  for (int g = 0; g < generations; g++) update_cells(board);
+  const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  std::cout << "cpu: " << (double)width * height * generations / elapsed << " cells/s" << std::endl;
+
+  FragmentLife fragment(width, height);
+  int result = check_engine("fragment shader", fragment, start, board, generations);
+  if (compute_supported()) {
+    ComputeLife compute(width, height);
+    result |= check_engine("compute shader", compute, start, board, generations);
+  } else {
+    std::cout << "compute shader: needs GL 4.3, skipped" << std::endl;
+  }
+  return result;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "life.hpp"
+#include "shader.hpp"
+
+// board stepped on the GPU, without leaving it
+class GpuLife {
+ public:
+  virtual ~GpuLife() = default;
+
+  // replaces the current generation with the board, which must have the size given at construction
+  virtual void upload(const Board &board) = 0;
+  // reads the current generation back into the board, marking every row dirty
+  virtual void download(Board &board) = 0;
+  virtual void step(int generations = 1) = 0;
+  // rebuilds the program when it uses one of the changed shaders, see ShaderProgram::reload
+  virtual void reload_shaders(const std::vector<std::string> &changed) = 0;
+
+  // current generation as a texture TextureRenderer can draw, packed tells which of its layouts
+  virtual unsigned int texture() = 0;
+  virtual bool packed() const = 0;
+};
+
+/**
+ * cells are a byte per cell GL_R8UI texture, one generation is a full screen pass of shaders/step.fs
+ * rendering into the other texture of the pair, which becomes the current one
+ * boards are limited to GL_MAX_TEXTURE_SIZE per side
+ */
+class FragmentLife : public GpuLife {
+ public:
+  // needs a current GL context
+  FragmentLife(int width, int height);
+  ~FragmentLife() override;
+  // step.fs specialized with the rule, for compile_programs
+  static ProgramSpec program();
+  FragmentLife(const FragmentLife &) = delete;
+  FragmentLife &operator=(const FragmentLife &) = delete;
+
+  void upload(const Board &board) override;
+  void download(Board &board) override;
+  void step(int generations = 1) override;
+  void reload_shaders(const std::vector<std::string> &changed) override;
+
+  unsigned int texture() override { return textures_[current_]; }
+  bool packed() const override { return false; }
+
+ private:
+  void setup_program();
+
+  int width_, height_;
+  ShaderProgram program_;
+  unsigned int vao_;
+  unsigned int textures_[2], framebuffers_[2];
+  int current_ = 0;
+};
+
+/**
+ * cells are bit packed in shader storage buffers, with the layout of Board::cells seen as 32 bit words
+ * shaders/step.comp computes a word per invocation, each work group first caching its 16x16 words
+ * and the ring of words around them in shared memory
+ * needs GL 4.3, see compute_supported
+ */
+class ComputeLife : public GpuLife {
+ public:
+  // needs a current GL context
+  ComputeLife(int width, int height);
+  ~ComputeLife() override;
+  static ProgramSpec program();
+  ComputeLife(const ComputeLife &) = delete;
+  ComputeLife &operator=(const ComputeLife &) = delete;
+
+  void upload(const Board &board) override;
+  void download(Board &board) override;
+  void step(int generations = 1) override;
+  void reload_shaders(const std::vector<std::string> &changed) override;
+
+  // copied from the current buffer on the GPU when it changed
+  unsigned int texture() override;
+  bool packed() const override { return true; }
+
+ private:
+  void setup_program();
+
+  int width_, height_;
+  // 64 bit words per row, like Board::stride
+  int stride_;
+  ShaderProgram program_;
+  unsigned int buffers_[2];
+  unsigned int texture_;
+  int current_ = 0;
+  bool texture_stale_ = true;
+};
+
+// compute shaders are core since GL 4.3, the context has to be current
+bool compute_supported();
+
+/**
+ * steps a random board on the CPU and with each GPU engine the context supports, and compares them
+ * needs a current GL context, returns 0 when they match
+ * works with software GL (LIBGL_ALWAYS_SOFTWARE=1 on mesa)
+ */
+int run_gpu_check(int width, int height, int generations, uint64_t seed, double density);
@@ -0,0 +1,109 @@
+#include "life.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// west neighbor of each cell in `center`, east neighbor and the cells themselves
+// a null row is a row outside of the board
+inline void load_row(const uint64_t *row, int i, int stride, uint64_t &west, uint64_t &center, uint64_t &east) {
+  if (row == nullptr) {
+    west = center = east = 0;
+    return;
+  }
+  center = row[i];
+  west = (center << 1) | (i > 0 ? row[i - 1] >> 63 : 0);
+  east = (center >> 1) | (i + 1 < stride ? row[i + 1] << 63 : 0);
+}
+
+}  // namespace
+
+Board make_board(int width, int height) {
+  Board board;
+  board.width = width;
+  board.height = height;
+  board.stride = (width + 63) / 64;
+  board.cells = CellBuffer((size_t)board.stride * height);
+  board.next = CellBuffer((size_t)board.stride * height);
+  board.dirty.assign(height, 1);
+  board.tiles.assign((size_t)board.stride * ((height + tile_rows - 1) / tile_rows), 1);
+  return board;
+}
+
+bool get_cell(const Board &board, int x, int y) {
+  if (x < 0 || y < 0 || x >= board.width || y >= board.height) return false;
+  return (board.cells[(size_t)y * board.stride + x / 64] >> (x % 64)) & 1;
+}
+
+void set_cell(Board &board, int x, int y, bool alive) {
+  if (x < 0 || y < 0 || x >= board.width || y >= board.height) return;
+  uint64_t &word = board.cells[(size_t)y * board.stride + x / 64];
+  board.dirty[y] = 1;
+  board.tiles[(size_t)(y / tile_rows) * board.stride + x / 64] = 1;
+  if (alive)
+    word |= uint64_t(1) << (x % 64);
+  else
+    word &= ~(uint64_t(1) << (x % 64));
+}
+
+void toggle_cell(Board &board, int x, int y) { set_cell(board, x, y, !get_cell(board, x, y)); }
+
+void clear_board(Board &board) {
+  std::fill(board.cells.begin(), board.cells.end(), 0);
+  mark_rows_changed(board, 0, board.height);
+}
+
+void mark_rows_changed(Board &board, int row_begin, int row_end) {
+  if (row_begin >= row_end) return;
+  std::fill(board.dirty.begin() + row_begin, board.dirty.begin() + row_end, 1);
+  std::fill(board.tiles.begin() + (size_t)(row_begin / tile_rows) * board.stride,
+            board.tiles.begin() + (size_t)((row_end - 1) / tile_rows + 1) * board.stride, 1);
+}
+
+void mark_clean(Board &board) {
+  std::fill(board.dirty.begin(), board.dirty.end(), 0);
+  std::fill(board.tiles.begin(), board.tiles.end(), 0);
+}
+
+long long population(const Board &board) {
+  long long count = 0;
+  for (uint64_t word : board.cells) count += popcount64(word);
+  return count;
+}
+
+uint64_t last_word_mask(int width) { return width % 64 == 0 ? ~uint64_t(0) : (uint64_t(1) << (width % 64)) - 1; }
+
+void step_rows(const uint64_t *src, uint64_t *dst, int width, int height, int stride, int row_begin, int row_end,
+               unsigned char *changed, unsigned char *changed_tiles) {
+  const uint64_t mask = last_word_mask(width);
+  for (int y = row_begin; y < row_end; y++) {
+    const uint64_t *above = y > 0 ? src + (size_t)(y - 1) * stride : nullptr;
+    const uint64_t *row = src + (size_t)y * stride;
+    const uint64_t *below = y < height - 1 ? src + (size_t)(y + 1) * stride : nullptr;
+    uint64_t *out = dst + (size_t)y * stride;
+    unsigned char *tiles = changed_tiles != nullptr ? changed_tiles + (size_t)(y / tile_rows) * stride : nullptr;
+
+    // writes word i of the row, returns the bits that differ from the current generation
+    auto step_word = [&](int i, uint64_t word_mask) {
+      uint64_t aw, ac, ae, rw, alive, re, bw, bc, be;
+      load_row(above, i, stride, aw, ac, ae);
+      load_row(row, i, stride, rw, alive, re);
+      load_row(below, i, stride, bw, bc, be);
+      out[i] = life_rule(aw, ac, ae, rw, re, bw, bc, be, alive) & word_mask;
+      return out[i] ^ alive;
+    };
+    uint64_t difference = 0;
+    for (int i = 0; i + 1 < stride; i++) difference |= step_word(i, ~uint64_t(0));
+    difference |= step_word(stride - 1, mask);
+    if (changed != nullptr && difference != 0) changed[y] = 1;
+    // words compared again while the rows are in cache, flagging in the loop above would slow it down
+    if (tiles != nullptr && difference != 0)
+      for (int i = 0; i < stride; i++) tiles[i] |= out[i] != row[i];
+  }
+}
+
+void update_cells(Board &board) {
+  step_rows(board.cells.data(), board.next.data(), board.width, board.height, board.stride, 0, board.height,
+            board.dirty.data(), board.tiles.data());
+  board.cells.swap(board.next);
+}
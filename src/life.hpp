@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "memory.hpp"
+
+// rows of a tile, the word of a row and the words below it up to the next multiple of tile_rows
+constexpr int tile_rows = 8;
+
+/**
+ * game state, one bit per cell
+ * each row is `stride` 64 bit words, cell x of a row lives in bit x % 64 of word x / 64
+ * bits past `width` in the last word of a row are always 0
+ * cells outside the board are considered dead
+ */
+struct Board {
+  int width = 0;
+  int height = 0;
+  int stride = 0;
+  CellBuffer cells;
+  // scratch buffer swapped with cells on each update
+  CellBuffer next;
+  // one flag per row changed since the last mark_clean, so renderers can upload only those
+  std::vector<unsigned char> dirty;
+  // one flag per tile changed since the last mark_clean, `stride` per row of tiles, for finer grained followers
+  // of the changes (see DensityPyramid)
+  std::vector<unsigned char> tiles;
+};
+
+Board make_board(int width, int height);
+
+bool get_cell(const Board &board, int x, int y);
+// out of board coordinates are ignored
+void set_cell(Board &board, int x, int y, bool alive);
+void toggle_cell(Board &board, int x, int y);
+void clear_board(Board &board);
+// flags rows [row_begin, row_end) and their tiles as changed, for writes to cells not going through set_cell
+void mark_rows_changed(Board &board, int row_begin, int row_end);
+// forgets the changed rows and tiles, to call once they are drawn
+void mark_clean(Board &board);
+
+// mask of the bits in use in the last word of a row
+uint64_t last_word_mask(int width);
+
+inline int popcount64(uint64_t x) {
+  x = x - ((x >> 1) & 0x5555555555555555);
+  x = (x & 0x3333333333333333) + ((x >> 2) & 0x3333333333333333);
+  x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0f;
+  return (int)((x * 0x0101010101010101) >> 56);
+}
+
+/**
+ * next state of 64 cells at once, bit i of each neighbor word being the neighbor of cell i
+ * the 8 neighbors are summed with full adders keeping the count modulo 8
+ * (8 neighbors wraps to 0 which is dead anyway)
+ */
+inline uint64_t life_rule(uint64_t n0, uint64_t n1, uint64_t n2, uint64_t n3, uint64_t n4, uint64_t n5, uint64_t n6,
+                          uint64_t n7, uint64_t alive) {
+  const uint64_t s0 = n0 ^ n1 ^ n2, c0 = (n0 & n1) | ((n0 ^ n1) & n2);
+  const uint64_t s1 = n3 ^ n4 ^ n5, c1 = (n3 & n4) | ((n3 ^ n4) & n5);
+  const uint64_t t = s0 ^ s1 ^ n6, c2 = (s0 & s1) | ((s0 ^ s1) & n6);
+  const uint64_t ones = t ^ n7, c3 = t & n7;
+  // c0..c3 each weigh 2
+  const uint64_t u = c0 ^ c1 ^ c2, c4 = (c0 & c1) | ((c0 ^ c1) & c2);
+  const uint64_t twos = u ^ c3;
+  const uint64_t fours = c4 ^ (u & c3);
+  // 3 neighbors, or 2 neighbors and alive
+  return twos & ~fours & (ones | alive);
+}
+
+// number of alive cells
+long long population(const Board &board);
+
+/**
+ * computes rows [row_begin, row_end) of the next generation from `src` into `dst`
+ * both buffers are `height` rows of `stride` words
+ * rows never write outside their own range so bands can be stepped concurrently
+ * when `changed` isn't null, changed[y] is set for each row that differs from src (and left as is otherwise)
+ * when `changed_tiles` isn't null, the same goes for the tiles of Board::tiles, then bands stepped concurrently
+ * must not share a row of tiles
+ */
+void step_rows(const uint64_t *src, uint64_t *dst, int width, int height, int stride, int row_begin, int row_end,
+               unsigned char *changed = nullptr, unsigned char *changed_tiles = nullptr);
+
+// advances the board by one generation
+void update_cells(Board &board);
@@ -1,18 +1,39 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
 #include <math.h>
 
-#include <helpers/RootDir.h>
-
+#include "batch.hpp"
+#include "census.hpp"
+#include "density.hpp"
+#include "distributed.hpp"
+#include "gpu.hpp"
+#include "life.hpp"
+#include "mapped.hpp"
+#include "memory.hpp"
+#include "parallel.hpp"
+#include "render.hpp"
 #include "shader.hpp"
+#include "soup.hpp"
+#include "timing.hpp"
 
 double cursor_x = 0;
 double cursor_y = 0;
 
-// double to avoid type casting on division
-constexpr double update_fps = 9;
+// generations per second while running, set with --rate and changed with the up and down arrows
+GenerationClock generation_clock(9);
+// "max" rate (--rate max or M), generations fill a slice of every frame instead, --frame-budget sets it
+bool max_throughput = false;
+FrameBudget frame_budget(0.012);
 
 constexpr int square_side = 10;
 constexpr int square_gutter = 1;
@@ -23,107 +44,212 @@ constexpr int window_height = 910;
 constexpr int squares_per_line = (window_width - square_gutter) / (square_side + square_gutter);
 constexpr int squares_per_column = (window_height - square_gutter) / (square_side + square_gutter);
 
-constexpr int grid_offset_x = window_width - squares_per_line * (square_side + square_gutter);
-constexpr int grid_offset_y = window_height - squares_per_column * (square_side + square_gutter);
+// the window grid, unless --board gives another size
+Board board = make_board(squares_per_line, squares_per_column);
+GridLayout layout;
 
-int cells[squares_per_line][squares_per_column];
+// moved with the mouse wheel and right button drags when the renderer can move (see Renderer::movable)
+Camera camera;
+bool camera_movable = false;
+bool panning = false;
+constexpr double zoom_per_notch = 1.25;
 
 bool should_update = false;
 
-constexpr GLfloat white[] = {1.0f, 1.0f, 1.0f, 1.0f};
-constexpr GLfloat black[] = {0.0f, 0.0f, 0.0f, 0.0f};
-constexpr GLfloat grey[] = {.5f, .5f, .5f, 0.8f};
+// set by whatever changes what's on screen, the loop waits for events as long as it's false
+bool needs_redraw = true;
+
+// random fill, overridable with --seed and --density
+double soup_density = 0.35;
+uint64_t soup_seed = std::chrono::steady_clock::now().time_since_epoch().count();
+
+// worker threads of the random fill and headless modes, 0 = one per core
+int threads = 0;
+
+// seconds between two frame time reports, 0 = never
+double frame_stats_interval = 0;
+
+// "instanced" or "texture", see create_renderer
+const char* renderer_name = "instanced";
+
+// set when the board lives on the GPU (--simulation gpu or compute), board is then only a copy for editing
+GpuLife* gpu_life = nullptr;
 
 // TODO: support window resizing
-void framebuffer_size_callback(GLFWwindow* window, int width, int height) { glViewport(0, 0, width, height); }
+void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+  glViewport(0, 0, width, height);
+  needs_redraw = true;
+}
+void window_refresh_callback(GLFWwindow* window) { needs_redraw = true; }
 static void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
+  if (panning) {
+    pan_camera(camera, xpos - cursor_x, ypos - cursor_y);
+    needs_redraw = true;
+  }
   cursor_x = xpos;
   cursor_y = ypos;
 }
 
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
+  if (!camera_movable) return;
+  zoom_camera(camera, layout, pow(zoom_per_notch, yoffset), cursor_x, cursor_y);
+  needs_redraw = true;
+}
+
 void find_corresponding_cell(double x, double y, int* cell_row, int* cell_col) {
-  // cells can be offset by one pixel due to grid_offset * .5 rounding
-  *cell_row = floor((x - grid_offset_x * .5) / (double)(square_side + square_gutter));
-  *cell_col = floor((y - grid_offset_y * .5) / (double)(square_side + square_gutter));
+  camera_cell(camera, layout, x, y, cell_row, cell_col);
 }
 
 // TODO: support mouse hold
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
+  if (button == GLFW_MOUSE_BUTTON_RIGHT) panning = camera_movable && action == GLFW_PRESS;
   if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
     int hovered_row, hovered_col;
     find_corresponding_cell(cursor_x, cursor_y, &hovered_row, &hovered_col);
-    if (cells[hovered_row][hovered_col] == 1)
-      cells[hovered_row][hovered_col] = 0;
-    else
-      cells[hovered_row][hovered_col] = 1;
+    if (gpu_life != nullptr) gpu_life->download(board);
+    toggle_cell(board, hovered_row, hovered_col);
+    if (gpu_life != nullptr) gpu_life->upload(board);
+    needs_redraw = true;
   }
 }
 
-void space_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
-  if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) should_update = !should_update;
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+  if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
+    should_update = !should_update;
+    // the pause isn't time to catch up on
+    if (should_update) generation_clock.restart(glfwGetTime());
+  }
+  if (key == GLFW_KEY_M && action == GLFW_PRESS) {
+    max_throughput = !max_throughput;
+    generation_clock.restart(glfwGetTime());
+    if (max_throughput)
+      std::cout << "max rate, generations filling " << frame_budget.seconds() * 1000 << " ms of each frame"
+                << std::endl;
+    else
+      std::cout << generation_clock.rate() << " generations/s" << std::endl;
+  }
+  if ((key == GLFW_KEY_UP || key == GLFW_KEY_DOWN) && action != GLFW_RELEASE) {
+    generation_clock.set_rate(generation_clock.rate() * (key == GLFW_KEY_UP ? 2 : .5));
+    std::cout << generation_clock.rate() << " generations/s" << std::endl;
+  }
+  if (key == GLFW_KEY_R && action == GLFW_PRESS) {
+    std::cout << "random fill, seed " << soup_seed << " density " << soup_density << std::endl;
+    fill_random(board, soup_seed++, soup_density, threads);
+    if (gpu_life != nullptr) gpu_life->upload(board);
+    needs_redraw = true;
+  }
 }
 
-void update_cells(int cells[squares_per_line][squares_per_column]) {
-  int new_cells[squares_per_line][squares_per_column];
-  std::copy(&cells[0][0], &cells[0][0] + squares_per_line * squares_per_column, &new_cells[0][0]);
-
-  for (int row = 0; row < squares_per_line; row++) {
-    for (int col = 0; col < squares_per_column; col++) {
-      int neighbors = 0;
-      // TODO: refactor neighbors counting
-      if (row > 0 && col > 0) {
-        neighbors += cells[row - 1][col - 1];
-        neighbors += cells[row - 1][col];
-        neighbors += cells[row][col - 1];
-        if (row < squares_per_line - 1 && col < squares_per_column - 1) {
-          neighbors += cells[row + 1][col + 1];
-          neighbors += cells[row + 1][col];
-          neighbors += cells[row + 1][col - 1];
-          neighbors += cells[row][col + 1];
-          neighbors += cells[row - 1][col + 1];
-        } else if (col == squares_per_column - 1) {
-          neighbors += cells[row + 1][col - 1];
-          neighbors += cells[row + 1][col];
-        } else if (row == squares_per_line - 1) {
-          neighbors += cells[row - 1][col + 1];
-          neighbors += cells[row][col + 1];
-        }
-      } else if (row > 0) {  // col = 0
-        neighbors += cells[row - 1][col + 1];
-        neighbors += cells[row - 1][col];
-        neighbors += cells[row][col + 1];
-        if (row < squares_per_line - 1) {
-          neighbors += cells[row + 1][col + 1];
-          neighbors += cells[row + 1][col];
-        }
-      } else if (col > 0) {  // row = 0
-        neighbors += cells[row][col - 1];
-        neighbors += cells[row + 1][col - 1];
-        neighbors += cells[row + 1][col];
-        if (col < squares_per_column - 1) {
-          neighbors += cells[row][col + 1];
-          neighbors += cells[row + 1][col + 1];
-        }
-      } else {  // row = 0 && col = 0
-        neighbors += cells[row + 1][col];
-        neighbors += cells[row][col + 1];
-        neighbors += cells[row + 1][col + 1];
-      }
+// modes running without a window
+enum class Headless { none, census, bench_batch, distributed, bench_mapped, bench_parallel, bench_pages };
+
+int main(int argc, char** argv) {
+  Headless headless = Headless::none;
+  CensusOptions census;
+  int batch_boards = 0;
+  DistributedOptions distributed;
+  const char* mapped_path = NULL;
+  int parallel_threads = 0;
+  // board of the distributed, mapped and parallel modes, and of the window when given
+  int board_width = 4096;
+  int board_height = 4096;
+  bool board_given = false;
+  int generations = 100;
+  // "cpu" for update_cells, "gpu" for a fragment shader or "compute" for a compute shader
+  const char* simulation = "cpu";
+  int gpu_check_generations = 0;
+  // linked programs saved there, "none" to always compile
+  const char* shader_cache = "shader_cache";
+  // shaders read from there instead of the embedded ones
+  const char* shader_dir = "";
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--seed") == 0)
+      soup_seed = strtoull(argv[i + 1], NULL, 10);
+    else if (strcmp(argv[i], "--density") == 0)
+      soup_density = atof(argv[i + 1]);
+    else if (strcmp(argv[i], "--census") == 0) {
+      census.soups = atoll(argv[i + 1]);
+      headless = Headless::census;
+    } else if (strcmp(argv[i], "--bench-batch") == 0) {
+      batch_boards = atoi(argv[i + 1]);
+      headless = Headless::bench_batch;
+    } else if (strcmp(argv[i], "--distributed") == 0 || strcmp(argv[i], "--distributed-test") == 0) {
+      distributed.workers = atoi(argv[i + 1]);
+      distributed.verify = strcmp(argv[i], "--distributed-test") == 0;
+      headless = Headless::distributed;
+    } else if (strcmp(argv[i], "--bench-mapped") == 0) {
+      mapped_path = argv[i + 1];
+      headless = Headless::bench_mapped;
+    } else if (strcmp(argv[i], "--bench-parallel") == 0) {
+      parallel_threads = atoi(argv[i + 1]);
+      headless = Headless::bench_parallel;
+    } else if (strcmp(argv[i], "--bench-pages") == 0) {
+      generations = atoi(argv[i + 1]);
+      headless = Headless::bench_pages;
+    } else if (strcmp(argv[i], "--pages") == 0) {
+      if (strcmp(argv[i + 1], "thp") == 0)
+        set_page_size(PageSize::transparent_huge);
+      else if (strcmp(argv[i + 1], "huge") == 0)
+        set_page_size(PageSize::huge);
+      else
+        set_page_size(PageSize::normal);
+    } else if (strcmp(argv[i], "--rate") == 0) {
+      max_throughput = strcmp(argv[i + 1], "max") == 0;
+      if (!max_throughput) generation_clock.set_rate(atof(argv[i + 1]));
+    } else if (strcmp(argv[i], "--frame-budget") == 0) {
+      frame_budget.set_seconds(atof(argv[i + 1]) / 1000);
+    } else if (strcmp(argv[i], "--frame-stats") == 0) {
+      frame_stats_interval = atof(argv[i + 1]);
+    } else if (strcmp(argv[i], "--renderer") == 0) {
+      renderer_name = argv[i + 1];
+    } else if (strcmp(argv[i], "--simulation") == 0) {
+      simulation = argv[i + 1];
+    } else if (strcmp(argv[i], "--gpu-check") == 0) {
+      gpu_check_generations = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "--shader-cache") == 0) {
+      shader_cache = argv[i + 1];
+    } else if (strcmp(argv[i], "--shader-dir") == 0) {
+      shader_dir = argv[i + 1];
+    } else if (strcmp(argv[i], "--board") == 0) {
+      board_given = sscanf(argv[i + 1], "%dx%d", &board_width, &board_height) == 2;
+    } else if (strcmp(argv[i], "--generations") == 0) {
+      generations = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "--census-out") == 0)
+      census.output = argv[i + 1];
+    else if (strcmp(argv[i], "--threads") == 0)
+      threads = atoi(argv[i + 1]);
+  }
 
-      if (neighbors == 3)
-        new_cells[row][col] = 1;
-      else if (neighbors != 2)
-        new_cells[row][col] = 0;
-    }
+  switch (headless) {
+    case Headless::census:
+      census.seed = soup_seed;
+      census.threads = threads;
+      return run_census(census);
+    case Headless::bench_batch:
+      return run_batch_benchmark(batch_boards, 16, 16, 1000);
+    case Headless::distributed:
+      distributed.width = board_width;
+      distributed.height = board_height;
+      distributed.generations = generations;
+      distributed.seed = soup_seed;
+      distributed.density = soup_density;
+      return run_distributed(distributed);
+    case Headless::bench_mapped:
+      return run_mapped_benchmark(mapped_path, board_width, board_height, generations, soup_seed, soup_density);
+    case Headless::bench_parallel:
+      return run_parallel_benchmark(parallel_threads, board_width, board_height, generations, soup_seed, soup_density);
+    case Headless::bench_pages:
+      return run_page_benchmark(board_width, board_height, generations, soup_seed, soup_density);
+    case Headless::none:
+      break;
   }
-  std::copy(&new_cells[0][0], &new_cells[0][0] + squares_per_line * squares_per_column, &cells[0][0]);
-}
 
-int main() {
   glfwInit();
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  // the gpu check only needs a context
+  if (gpu_check_generations > 0) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
   GLFWwindow* window = glfwCreateWindow(window_width, window_height, "Game of life", NULL, NULL);
   if (window == NULL) {
@@ -139,82 +265,220 @@ int main() {
     return -1;
   }
 
+  if (strcmp(shader_cache, "none") != 0) set_program_cache(shader_cache);
+  set_shader_directory(shader_dir);
+
+  if (gpu_check_generations > 0) {
+    const int result = run_gpu_check(board_width, board_height, gpu_check_generations, soup_seed, soup_density);
+    glfwTerminate();
+    return result;
+  }
+
   glViewport(0, 0, window_width, window_height);
 
+  if (board_given) {
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+    if (board_width < 1 || board_height < 1 || board_width > max_size || board_height > max_size) {
+      std::cout << "ERROR board sides go from 1 to the " << max_size << " texels textures can have" << std::endl;
+      glfwTerminate();
+      return 1;
+    }
+    board = make_board(board_width, board_height);
+  }
+  // the instanced renderer only draws the window grid
+  const bool fits = board.width <= squares_per_line && board.height <= squares_per_column;
+  if (!fits && strcmp(renderer_name, "texture") != 0 && strcmp(renderer_name, "packed") != 0) {
+    std::cout << board.width << "x" << board.height << " board larger than the window, packed renderer" << std::endl;
+    renderer_name = "packed";
+  }
+
   glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+  glfwSetWindowRefreshCallback(window, window_refresh_callback);
   glfwSetCursorPosCallback(window, cursor_position_callback);
   glfwSetMouseButtonCallback(window, mouse_button_callback);
-  glfwSetKeyCallback(window, space_callback);
-
-  float vertices[] = {
-      -(square_side * .5f) / (window_width * .5f), (square_side * .5f) / (window_height * .5f),  .0f,  // top left
-      (square_side * .5f) / (window_width * .5f),  (square_side * .5f) / (window_height * .5f),  .0f,  // top right
-      -(square_side * .5f) / (window_width * .5f), -(square_side * .5f) / (window_height * .5f), .0f,  // bottom left
-      (square_side * .5f) / (window_width * .5f),  -(square_side * .5f) / (window_height * .5f), .0f,  // bottom right
-  };
-
-  unsigned int indices[] = {0, 1, 2, 1, 2, 3};
-
-  unsigned int VAO;
-  glGenVertexArrays(1, &VAO);
-  glBindVertexArray(VAO);
-
-  unsigned int VBO;
-  glGenBuffers(1, &VBO);
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-  unsigned int EBO;
-  glGenBuffers(1, &EBO);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-  glEnableVertexAttribArray(0);
-
-  int shader_id = create_shader_program(ROOT_DIR "shaders/vertex.vs", ROOT_DIR "shaders/fragment.fs");
-  if (shader_id == -1) std::cout << "Error while parsing/compiling shaders" << std::endl;
-
-  double total_time = 0;
+  glfwSetKeyCallback(window, key_callback);
+  glfwSetScrollCallback(window, scroll_callback);
+
+  layout = {board.width, board.height, square_side, square_gutter, window_width, window_height};
+  camera = default_camera(layout);
+  // every program of the run compiled at once, the renderer and the engine constructors pick them up
+  void* max_shader_compiler_threads = nullptr;
+  if (glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+    max_shader_compiler_threads = (void*)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+  if (max_shader_compiler_threads == nullptr && glfwExtensionSupported("GL_ARB_parallel_shader_compile"))
+    max_shader_compiler_threads = (void*)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+  enable_parallel_compile(max_shader_compiler_threads);
+  const bool compute = strcmp(simulation, "compute") == 0 && compute_supported();
+  std::vector<ProgramSpec> run_programs;
+  if (strcmp(simulation, "gpu") == 0)
+    run_programs.push_back(FragmentLife::program());
+  else if (compute)
+    run_programs.push_back(ComputeLife::program());
+  if (strcmp(simulation, "gpu") == 0 || compute)
+    run_programs.push_back(TextureRenderer::program(layout, compute));
+  else if (strcmp(renderer_name, "texture") == 0 || strcmp(renderer_name, "packed") == 0)
+    run_programs.push_back(TextureRenderer::program(layout, strcmp(renderer_name, "packed") == 0));
+  else
+    run_programs.push_back(InstancedRenderer::program(layout));
+  compile_programs(run_programs);
+
+  std::unique_ptr<Renderer> renderer;
+  // draws the gpu generations without them coming back to the cpu
+  TextureRenderer* gpu_renderer = nullptr;
+  std::unique_ptr<GpuLife> gpu_engine;
+  if (strcmp(simulation, "gpu") == 0) {
+    gpu_engine.reset(new FragmentLife(board.width, board.height));
+  } else if (strcmp(simulation, "compute") == 0) {
+    if (compute_supported())
+      gpu_engine.reset(new ComputeLife(board.width, board.height));
+    else
+      std::cout << "compute shaders need GL 4.3, simulating on the cpu" << std::endl;
+  }
+  if (gpu_engine != nullptr) {
+    gpu_life = gpu_engine.get();
+    gpu_life->upload(board);
+    gpu_renderer = new TextureRenderer(layout, gpu_life->packed());
+    renderer.reset(gpu_renderer);
+  } else {
+    renderer = create_renderer(renderer_name, layout);
+  }
+  camera_movable = renderer->movable();
+  // only boards simulated on the cpu have their live counts for the zoomed out views
+  std::unique_ptr<DensityPyramid> density;
+  if (gpu_life == nullptr && camera_movable) {
+    density.reset(new DensityPyramid(board));
+    renderer->set_density(density.get());
+  }
+  // a spec of run_programs built differently by the constructors would otherwise hold its GL objects forever
+  discard_pending_programs();
+  // compiling on the first run (cold), loading the binaries on the next ones (warm)
+  const ProgramStats programs = program_stats();
+  std::cout << programs.compiled << " shader programs compiled, " << programs.cached << " loaded from the cache, in "
+            << programs.seconds * 1000 << " ms" << std::endl;
+
+  // edits of the shader directory are picked up between two frames
+  std::unique_ptr<ShaderWatcher> shader_watcher;
+  if (shader_dir[0] != '\0') shader_watcher.reset(new ShaderWatcher(shader_dir));
+  // seconds between two looks at the directory while nothing else wakes the loop
+  constexpr double shader_watch_interval = 0.2;
+
+  // the hovered cell on screen, a redraw moves the highlight when the cursor enters another one
+  int drawn_row = -1, drawn_col = -1;
+  // cpu time spent on updating and submitting frames, reported every frame_stats_interval seconds
+  double frame_time = 0;
+  int frames = 0;
+  long long uploaded_bytes = 0;
+  // generations run, compared in the frame stats to the ones the clock asked for
+  long long generations_run = 0;
+  double requested = 0;
+  long long dropped = 0;
+  double frame_stats_start = glfwGetTime();
+  // process cpu time while paused, reported for each minute of it with the frame stats
+  constexpr double idle_report_interval = 60;
+  double idle_start = -1, idle_cpu_start = 0;
+  int idle_frames = 0;
   while (!glfwWindowShouldClose(window)) {
-    double start_time = glfwGetTime();
-    glfwSwapBuffers(window);
-    glfwPollEvents();
-
-    // TODO: should display indication that game is stopped
-    if ((1 / update_fps) - total_time < 0.001 && should_update) {
-      update_cells(cells);
-      total_time = 0;
+    // sleeps until an event, the next generation, the next idle report or the next look at the shader directory,
+    // nothing else changes the screen, a negative wait being until an event
+    double wait = -1;
+    if (should_update)
+      wait = generation_clock.until_next(glfwGetTime());
+    else if (frame_stats_interval > 0 && idle_start >= 0)
+      wait = std::max(idle_start + idle_report_interval - glfwGetTime(), 0.0);
+    // saving a shader isn't an event of the window
+    if (shader_watcher != nullptr) wait = wait < 0 ? shader_watch_interval : std::min(wait, shader_watch_interval);
+    if (needs_redraw)
+      glfwPollEvents();
+    else if (wait >= 0)
+      glfwWaitEventsTimeout(wait);
+    else
+      glfwWaitEvents();
+    double frame_start = glfwGetTime();
+
+    if (shader_watcher != nullptr) {
+      const std::vector<std::string> changed = shader_watcher->changed();
+      if (!changed.empty()) {
+        renderer->reload_shaders(changed);
+        if (gpu_life != nullptr) gpu_life->reload_shaders(changed);
+        needs_redraw = true;
+      }
     }
 
-    // render
-    glUseProgram(shader_id);
-    glBindVertexArray(VAO);
-
-    int is_alive_loc = glGetUniformLocation(shader_id, "is_alive");
-    int offset_loc = glGetUniformLocation(shader_id, "offset");
-
-    for (int row = -squares_per_line / 2; row < squares_per_line / 2; row++) {
-      for (int col = -squares_per_column / 2; col < squares_per_column / 2; col++) {
-        // coloring
-        int hovered_row, hovered_col;
-        find_corresponding_cell(cursor_x, cursor_y, &hovered_row, &hovered_col);
-        if ((row + squares_per_line / 2) == hovered_row && (col + (squares_per_column / 2)) == hovered_col)
-          glUniform4fv(is_alive_loc, 1, grey);
-        else if (cells[row + squares_per_line / 2][col + (squares_per_column / 2)] == 1)
-          glUniform4fv(is_alive_loc, 1, black);
+    // TODO: should display indication that game is stopped
+    if (should_update) {
+      // a fixed rate the board can't keep up with still only takes the frame budget, the rest is dropped
+      const int due =
+          max_throughput ? frame_budget.batch() : generation_clock.advance(frame_start, frame_budget.batch());
+      if (due > 0) {
+        const double step_start = glfwGetTime();
+        if (gpu_life != nullptr)
+          gpu_life->step(due);
         else
-          glUniform4fv(is_alive_loc, 1, white);
+          for (int g = 0; g < due; g++) update_cells(board);
+        // the gpu steps are only queued, their cost shows once they're done
+        if (gpu_life != nullptr) glFinish();
+        frame_budget.record(due, glfwGetTime() - step_start);
+        generations_run += due;
+        needs_redraw = true;
+      }
+    }
 
-        // placing
-        const float offset_x = (square_side + square_gutter) * row + (square_side * .5);
-        const float offset_y = -(square_side + square_gutter) * col - (square_side * .5);
-        glUniform2f(offset_loc, offset_x / (window_width * .5), offset_y / (window_height * .5));
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    int hovered_row, hovered_col;
+    find_corresponding_cell(cursor_x, cursor_y, &hovered_row, &hovered_col);
+    if (hovered_row != drawn_row || hovered_col != drawn_col) needs_redraw = true;
+
+    if (needs_redraw) {
+      renderer->set_camera(camera);
+      if (gpu_renderer != nullptr) {
+        gpu_renderer->draw_texture(gpu_life->texture(), hovered_row, hovered_col);
+      } else {
+        if (density != nullptr) density->update(board);
+        renderer->draw(board, hovered_row, hovered_col);
+        mark_clean(board);
+        if (density != nullptr) density->mark_clean();
       }
+      glfwSwapBuffers(window);
+      drawn_row = hovered_row;
+      drawn_col = hovered_col;
+      needs_redraw = false;
+      frame_time += glfwGetTime() - frame_start;
+      frames++;
+      idle_frames++;
     }
-    glBindVertexArray(0);
 
-    total_time += glfwGetTime() - start_time;
+    if (frame_stats_interval > 0 && glfwGetTime() - frame_stats_start >= frame_stats_interval && frames > 0) {
+      const double elapsed = glfwGetTime() - frame_stats_start;
+      std::cout << frames << " frames, " << frame_time / frames * 1000 << " ms of cpu per frame, "
+                << (renderer->uploaded_bytes() - uploaded_bytes) / frames << " bytes uploaded per frame" << std::endl;
+      if (max_throughput && generations_run > 0)
+        std::cout << generations_run / elapsed << " generations/s, batches of " << frame_budget.batch() << ", "
+                  << frame_budget.seconds_per_generation() * 1000 << " ms per generation" << std::endl;
+      else if (generation_clock.requested() > requested)
+        std::cout << generations_run / elapsed << " generations/s of the "
+                  << (generation_clock.requested() - requested) / elapsed << " requested, "
+                  << generation_clock.dropped() - dropped << " dropped" << std::endl;
+      if (density != nullptr)
+        std::cout << density->population() << " live cells, " << density->occupied(0) << " of "
+                  << (long long)density->columns(0) * density->rows(0) << " 8x8 blocks occupied" << std::endl;
+      uploaded_bytes = renderer->uploaded_bytes();
+      generations_run = 0;
+      requested = generation_clock.requested();
+      dropped = generation_clock.dropped();
+      frame_time = 0;
+      frames = 0;
+      frame_stats_start = glfwGetTime();
+    }
+
+    if (should_update) {
+      idle_start = -1;
+    } else if (idle_start < 0 || glfwGetTime() - idle_start >= idle_report_interval) {
+      if (idle_start >= 0 && frame_stats_interval > 0)
+        std::cout << "paused: " << (process_cpu_seconds() - idle_cpu_start) / (glfwGetTime() - idle_start) * 100
+                  << "% of a core over the last minute, " << idle_frames << " redraws" << std::endl;
+      idle_start = glfwGetTime();
+      idle_cpu_start = process_cpu_seconds();
+      idle_frames = 0;
+    }
   }
 }
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "mapped.hpp"
+
+#include <iostream>
+
+#ifdef _WIN32
+
+bool open_mapped_board(MappedBoard &board, const char *path, int width, int height) {
+  std::cout << "ERROR memory mapped boards are not available on windows" << std::endl;
+  return false;
+}
+void close_mapped_board(MappedBoard &board) {}
+void fill_mapped_random(MappedBoard &board, uint64_t seed, double density) {}
+void update_mapped(MappedBoard &board, int band_rows) {}
+int run_mapped_benchmark(const char *path, int width, int height, int generations, uint64_t seed, double density) {
+  MappedBoard board;
+  return open_mapped_board(board, path, width, height) ? 0 : 1;
+}
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+
+#include "life.hpp"
+#include "memory.hpp"
+#include "soup.hpp"
+
+namespace {
+
+constexpr char magic[8] = {'G', 'O', 'L', 'B', 'O', 'A', 'R', 'D'};
+constexpr size_t header_bytes = 4096;
+constexpr size_t default_band_bytes = 64 << 20;
+
+struct Header {
+  char magic[8];
+  int64_t width;
+  int64_t height;
+  int64_t generation;
+};
+
+size_t row_bytes(const MappedBoard &board) { return board.stride * sizeof(uint64_t); }
+
+// applies advice to the whole pages inside rows [first, last)
+void advise_rows(const MappedBoard &board, int first, int last, int advice) {
+  static const size_t page = sysconf(_SC_PAGESIZE);
+  if (first >= last) return;
+  size_t begin = (size_t)((char *)board.cells - board.map) + first * row_bytes(board);
+  size_t end = (size_t)((char *)board.cells - board.map) + last * row_bytes(board);
+  begin = (begin + page - 1) / page * page;
+  end = end / page * page;
+  if (begin < end) madvise(board.map + begin, end - begin, advice);
+}
+
+// starts writing rows [first, last) to disk and drops them from our address space, the data stays in the page cache
+void write_behind(const MappedBoard &board, int first, int last) {
+#ifdef __linux__
+  sync_file_range(board.fd, header_bytes + first * row_bytes(board), (last - first) * row_bytes(board),
+                  SYNC_FILE_RANGE_WRITE);
+#endif
+  advise_rows(board, first, last, MADV_DONTNEED);
+}
+
+void write_header(MappedBoard &board) {
+  Header header;
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.width = board.width;
+  header.height = board.height;
+  header.generation = board.generation;
+  std::memcpy(board.map, &header, sizeof(header));
+}
+
+int band_rows_for(const MappedBoard &board, int band_rows) {
+  if (band_rows > 0) return band_rows;
+  return (int)std::max<size_t>(1, default_band_bytes / row_bytes(board));
+}
+
+}  // namespace
+
+bool open_mapped_board(MappedBoard &board, const char *path, int width, int height) {
+  board.fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (board.fd < 0) {
+    std::cout << "ERROR could not open " << path << std::endl;
+    return false;
+  }
+  struct stat info;
+  if (fstat(board.fd, &info) != 0) {
+    std::cout << "ERROR could not stat " << path << std::endl;
+    close_mapped_board(board);
+    return false;
+  }
+
+  Header header = {};
+  if (info.st_size == 0) {
+    board.width = width;
+    board.height = height;
+    board.stride = (width + 63) / 64;
+    board.generation = 0;
+    // sparse file, pages are only allocated once written
+    if (ftruncate(board.fd, header_bytes + (off_t)board.height * row_bytes(board)) != 0) {
+      std::cout << "ERROR could not grow " << path << " to the board size" << std::endl;
+      close_mapped_board(board);
+      return false;
+    }
+  } else if (pread(board.fd, &header, sizeof(header), 0) != sizeof(header) ||
+             std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.width <= 0 || header.height <= 0 ||
+             header.width > INT_MAX || header.height > INT_MAX) {
+    std::cout << "ERROR " << path << " is not a board file" << std::endl;
+    close_mapped_board(board);
+    return false;
+  } else {
+    board.width = (int)header.width;
+    board.height = (int)header.height;
+    board.stride = (board.width + 63) / 64;
+    board.generation = header.generation;
+    // a truncated or partly copied file would fault on the first row past its end
+    if (info.st_size < (off_t)header_bytes + (off_t)board.height * (off_t)row_bytes(board)) {
+      std::cout << "ERROR " << path << " is not a board file, shorter than its " << board.width << "x"
+                << board.height << " board" << std::endl;
+      close_mapped_board(board);
+      return false;
+    }
+    if ((width > 0 && width != board.width) || (height > 0 && height != board.height)) {
+      std::cout << "ERROR " << path << " holds a " << board.width << "x" << board.height << " board" << std::endl;
+      close_mapped_board(board);
+      return false;
+    }
+  }
+
+  board.map_bytes = header_bytes + (size_t)board.height * row_bytes(board);
+  void *map = mmap(nullptr, board.map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, board.fd, 0);
+  if (map == MAP_FAILED) {
+    std::cout << "ERROR could not map " << path << std::endl;
+    board.map = nullptr;
+    close_mapped_board(board);
+    return false;
+  }
+  board.map = (char *)map;
+  board.cells = (uint64_t *)(board.map + header_bytes);
+  madvise(board.map, board.map_bytes, MADV_SEQUENTIAL);
+  write_header(board);
+  return true;
+}
+
+void close_mapped_board(MappedBoard &board) {
+  if (board.map != nullptr) munmap(board.map, board.map_bytes);
+  if (board.fd >= 0) close(board.fd);
+  board.map = nullptr;
+  board.cells = nullptr;
+  board.fd = -1;
+}
+
+void fill_mapped_random(MappedBoard &board, uint64_t seed, double density) {
+  const uint64_t mask = last_word_mask(board.width);
+  const int band = band_rows_for(board, 0);
+  for (int first = 0; first < board.height; first += band) {
+    const int last = std::min(board.height, first + band);
+    for (int y = first; y < last; y++) {
+      uint64_t *row = board.cells + (size_t)y * board.stride;
+      for (int i = 0; i < board.stride; i++) row[i] = soup_word(seed, density, y, i);
+      row[board.stride - 1] &= mask;
+    }
+    write_behind(board, first, last);
+  }
+  board.generation = 0;
+  write_header(board);
+}
+
+void update_mapped(MappedBoard &board, int band_rows) {
+  const int band = band_rows_for(board, band_rows);
+  // bands are stepped into scratch and copied back one band late, once the next band has read their last row
+  CellBuffer scratch[2] = {CellBuffer((size_t)(band + 2) * board.stride),
+                           CellBuffer((size_t)(band + 2) * board.stride)};
+  int pending_first = 0, pending_last = 0, pending_offset = 0;
+
+  auto write_back = [&](int buffer) {
+    std::memcpy(board.cells + (size_t)pending_first * board.stride,
+                scratch[buffer].data() + (size_t)pending_offset * board.stride,
+                (pending_last - pending_first) * row_bytes(board));
+    write_behind(board, pending_first, pending_last);
+  };
+
+  int buffer = 0;
+  for (int first = 0; first < board.height; first += band, buffer ^= 1) {
+    const int last = std::min(board.height, first + band);
+    advise_rows(board, last, std::min(board.height, last + band + 1), MADV_WILLNEED);
+
+    // the band and the rows right above and below it, stepped as a small board of its own
+    const int view_first = std::max(0, first - 1);
+    const int view_last = std::min(board.height, last + 1);
+    step_rows(board.cells + (size_t)view_first * board.stride, scratch[buffer].data(), board.width,
+              view_last - view_first, board.stride, first - view_first, last - view_first);
+
+    if (first > 0) write_back(buffer ^ 1);
+    pending_first = first;
+    pending_last = last;
+    pending_offset = first - view_first;
+  }
+  write_back(buffer ^ 1);
+
+  board.generation++;
+  write_header(board);
+}
+
+int run_mapped_benchmark(const char *path, int width, int height, int generations, uint64_t seed, double density) {
+  MappedBoard mapped;
+  if (!open_mapped_board(mapped, path, width, height)) return 1;
+  std::cout << mapped.width << "x" << mapped.height << " board mapped from " << path << ", " << generations
+            << " generations" << std::endl;
+  const double cells = (double)mapped.width * mapped.height * generations;
+
+  fill_mapped_random(mapped, seed, density);
+  auto start = std::chrono::steady_clock::now();
+  for (int g = 0; g < generations; g++) update_mapped(mapped);
+  const double mapped_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "mapped:    " << cells / mapped_time << " cells/s" << std::endl;
+
+  int result = 0;
+  if ((size_t)mapped.height * row_bytes(mapped) <= (size_t)1 << 30) {
+    Board board = make_board(mapped.width, mapped.height);
+    fill_random(board, seed, density);
+    start = std::chrono::steady_clock::now();
+    for (int g = 0; g < generations; g++) update_cells(board);
+    const double memory_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "in memory: " << cells / memory_time << " cells/s (mapped is " << memory_time / mapped_time << "x)"
+              << std::endl;
+    if (std::memcmp(board.cells.data(), mapped.cells, board.cells.size() * sizeof(uint64_t)) != 0) {
+      std::cout << "ERROR mapped and in memory boards differ" << std::endl;
+      result = 1;
+    }
+  }
+  close_mapped_board(mapped);
+  return result;
+}
+
+#endif
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * board living in a memory mapped file, for boards larger than memory
+ * the file is a one page header followed by the rows, laid out like Board::cells
+ * generations are computed in place band by band so memory use is a few bands, whatever the board size:
+ * the next band is read ahead while the current one is stepped into a scratch buffer,
+ * and the previous one is written back and its writeback started before being dropped from memory
+ */
+struct MappedBoard {
+  int width = 0;
+  int height = 0;
+  int stride = 0;
+  long long generation = 0;
+  int fd = -1;
+  char *map = nullptr;
+  size_t map_bytes = 0;
+  // start of the rows, right after the header
+  uint64_t *cells = nullptr;
+};
+
+/**
+ * opens the board stored at path, or creates an empty one of width * height if there is none
+ * returns false (and prints why) if the file can't be mapped, holds a board of another size or is shorter
+ * than its board
+ */
+bool open_mapped_board(MappedBoard &board, const char *path, int width, int height);
+void close_mapped_board(MappedBoard &board);
+
+// same cells as fill_random on a Board of that size
+void fill_mapped_random(MappedBoard &board, uint64_t seed, double density);
+
+// advances the board by one generation, band_rows rows at a time (0 = about 64 MB per band)
+void update_mapped(MappedBoard &board, int band_rows = 0);
+
+/**
+ * steps a random board of width * height stored at path for `generations`
+ * and prints cells per second, compared with update_cells when the board fits in 1 GB
+ */
+int run_mapped_benchmark(const char *path, int width, int height, int generations, uint64_t seed, double density);
@@ -0,0 +1,234 @@
+#include "memory.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <utility>
+
+#include "life.hpp"
+#include "soup.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX 1
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+// smaller buffers come from the heap, they would mostly waste a page and a system call
+constexpr size_t heap_limit = 64 << 10;
+constexpr size_t huge_page_bytes = 2 << 20;
+
+PageSize current_page_size = PageSize::normal;
+
+#ifndef _WIN32
+// maps bytes rounded up to a whole number of 2 MB pages, aligned on 2 MB so every page can be a huge one
+void *map_transparent_huge(size_t bytes, size_t *mapping_bytes) {
+#ifdef MADV_HUGEPAGE
+  const size_t rounded = (bytes + huge_page_bytes - 1) / huge_page_bytes * huge_page_bytes;
+  char *memory = (char *)mmap(nullptr, rounded + huge_page_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                              -1, 0);
+  if (memory == MAP_FAILED) return nullptr;
+  char *aligned = (char *)(((uintptr_t)memory + huge_page_bytes - 1) / huge_page_bytes * huge_page_bytes);
+  if (aligned > memory) munmap(memory, aligned - memory);
+  munmap(aligned + rounded, memory + huge_page_bytes - aligned);
+  if (madvise(aligned, rounded, MADV_HUGEPAGE) != 0) {
+    munmap(aligned, rounded);
+    return nullptr;
+  }
+  *mapping_bytes = rounded;
+  return aligned;
+#else
+  return nullptr;
+#endif
+}
+
+void *map_huge(size_t bytes, size_t *mapping_bytes) {
+#ifdef MAP_HUGETLB
+  const size_t rounded = (bytes + huge_page_bytes - 1) / huge_page_bytes * huge_page_bytes;
+  void *memory = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (memory == MAP_FAILED) return nullptr;
+  *mapping_bytes = rounded;
+  return memory;
+#else
+  return nullptr;
+#endif
+}
+#endif
+
+#ifdef __linux__
+// data TLB read misses of this thread in user space, -1 when counters aren't available
+class TlbMissCounter {
+ public:
+  TlbMissCounter() {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+  ~TlbMissCounter() {
+    if (fd_ >= 0) close(fd_);
+  }
+  void start() {
+    if (fd_ < 0) return;
+    ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+  }
+  long long stop() {
+    if (fd_ < 0) return -1;
+    ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+    long long count = 0;
+    return read(fd_, &count, sizeof(count)) == sizeof(count) ? count : -1;
+  }
+
+ private:
+  int fd_ = -1;
+};
+#else
+class TlbMissCounter {
+ public:
+  void start() {}
+  long long stop() { return -1; }
+};
+#endif
+
+}  // namespace
+
+void set_page_size(PageSize pages) { current_page_size = pages; }
+
+PageSize page_size() { return current_page_size; }
+
+const char *page_size_name(PageSize pages) {
+  switch (pages) {
+    case PageSize::transparent_huge:
+      return "transparent huge pages";
+    case PageSize::huge:
+      return "hugetlbfs pages";
+    default:
+      return "normal pages";
+  }
+}
+
+CellBuffer::CellBuffer(size_t words) : size_(words) {
+  if (words == 0) return;
+  const size_t bytes = words * sizeof(uint64_t);
+  if (bytes < heap_limit) {
+    words_ = (uint64_t *)std::calloc(words, sizeof(uint64_t));
+    if (words_ == nullptr) throw std::bad_alloc();
+    return;
+  }
+
+#ifdef _WIN32
+  mapping_ = VirtualAlloc(NULL, bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  if (mapping_ == NULL) throw std::bad_alloc();
+#else
+  if (current_page_size == PageSize::huge && (mapping_ = map_huge(bytes, &mapping_bytes_)) != nullptr) {
+    pages_ = PageSize::huge;
+  } else if (current_page_size != PageSize::normal &&
+             (mapping_ = map_transparent_huge(bytes, &mapping_bytes_)) != nullptr) {
+    pages_ = PageSize::transparent_huge;
+  } else {
+    mapping_bytes_ = bytes;
+    mapping_ = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping_ == MAP_FAILED) {
+      mapping_ = nullptr;
+      throw std::bad_alloc();
+    }
+  }
+#endif
+  mapping_bytes_ = std::max(mapping_bytes_, bytes);
+  words_ = (uint64_t *)mapping_;
+}
+
+CellBuffer::CellBuffer(const CellBuffer &other) : CellBuffer(other.size_) {
+  std::copy(other.begin(), other.end(), words_);
+}
+
+CellBuffer::CellBuffer(CellBuffer &&other) noexcept { swap(other); }
+
+CellBuffer &CellBuffer::operator=(CellBuffer other) noexcept {
+  swap(other);
+  return *this;
+}
+
+CellBuffer::~CellBuffer() {
+  if (mapping_ == nullptr) {
+    std::free(words_);
+    return;
+  }
+#ifdef _WIN32
+  VirtualFree(mapping_, 0, MEM_RELEASE);
+#else
+  munmap(mapping_, mapping_bytes_);
+#endif
+}
+
+void CellBuffer::swap(CellBuffer &other) noexcept {
+  std::swap(words_, other.words_);
+  std::swap(size_, other.size_);
+  std::swap(mapping_, other.mapping_);
+  std::swap(mapping_bytes_, other.mapping_bytes_);
+  std::swap(pages_, other.pages_);
+}
+
+bool operator==(const CellBuffer &a, const CellBuffer &b) {
+  return a.size() == b.size() && (a.size() == 0 || std::memcmp(a.data(), b.data(), a.size() * sizeof(uint64_t)) == 0);
+}
+
+int run_page_benchmark(int width, int height, int generations, uint64_t seed, double density) {
+  const PageSize previous = page_size();
+  const double cells = (double)width * height * generations;
+  std::cout << width << "x" << height << " board, " << generations << " generations" << std::endl;
+
+  int result = 0;
+  CellBuffer reference;
+  for (PageSize pages : {PageSize::normal, PageSize::transparent_huge, PageSize::huge}) {
+    set_page_size(pages);
+    Board board = make_board(width, height);
+    fill_random(board, seed, density);
+
+    TlbMissCounter misses;
+    misses.start();
+    const auto start = std::chrono::steady_clock::now();
+    for (int g = 0; g < generations; g++) update_cells(board);
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const long long count = misses.stop();
+
+    std::cout << page_size_name(pages) << ": got " << page_size_name(board.cells.pages()) << ", "
+              << cells / elapsed << " cells/s, ";
+    if (count < 0)
+      std::cout << "TLB misses not available";
+    else
+      std::cout << count << " dTLB misses (" << count * 1e6 / cells << " per million cells)";
+    std::cout << std::endl;
+
+    if (pages == PageSize::normal)
+      reference = board.cells;
+    else if (board.cells != reference) {
+      std::cout << "ERROR boards differ between page sizes" << std::endl;
+      result = 1;
+    }
+  }
+  set_page_size(previous);
+  return result;
+}
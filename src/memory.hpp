@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * pages backing the large buffers allocated from now on
+ * 2 MB pages cover a big board with far fewer TLB entries than 4 KB ones
+ * transparent_huge asks the kernel to use them when it can (madvise(MADV_HUGEPAGE)),
+ * huge takes them from the reserved hugetlbfs pool and falls back to transparent_huge when it's empty
+ * windows and macos always get normal pages
+ */
+enum class PageSize { normal, transparent_huge, huge };
+
+void set_page_size(PageSize pages);
+PageSize page_size();
+const char *page_size_name(PageSize pages);
+
+/**
+ * zeroed words, large buffers are page aligned and straight from the OS
+ * their pages are only backed on first write, so on NUMA machines each page ends up
+ * on the node of the thread that writes it first, not the one that allocated it
+ */
+class CellBuffer {
+ public:
+  CellBuffer() = default;
+  explicit CellBuffer(size_t words);
+  CellBuffer(const CellBuffer &other);
+  CellBuffer(CellBuffer &&other) noexcept;
+  CellBuffer &operator=(CellBuffer other) noexcept;
+  ~CellBuffer();
+
+  uint64_t *data() { return words_; }
+  const uint64_t *data() const { return words_; }
+  size_t size() const { return size_; }
+  uint64_t *begin() { return words_; }
+  uint64_t *end() { return words_ + size_; }
+  const uint64_t *begin() const { return words_; }
+  const uint64_t *end() const { return words_ + size_; }
+  uint64_t &operator[](size_t i) { return words_[i]; }
+  const uint64_t &operator[](size_t i) const { return words_[i]; }
+
+  // the pages actually used, after any fallback
+  PageSize pages() const { return pages_; }
+
+  void swap(CellBuffer &other) noexcept;
+
+ private:
+  uint64_t *words_ = nullptr;
+  size_t size_ = 0;
+  // whole mapping, larger than the words when rounded up to huge pages
+  void *mapping_ = nullptr;
+  size_t mapping_bytes_ = 0;
+  PageSize pages_ = PageSize::normal;
+};
+
+bool operator==(const CellBuffer &a, const CellBuffer &b);
+inline bool operator!=(const CellBuffer &a, const CellBuffer &b) { return !(a == b); }
+
+/**
+ * steps a random board of width * height for `generations` with each page size
+ * and prints cells per second and data TLB misses (when the system lets us count them)
+ */
+int run_page_benchmark(int width, int height, int generations, uint64_t seed, double density);
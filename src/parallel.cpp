@@ -0,0 +1,239 @@
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "soup.hpp"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// "0-3,8-11" to {0, 1, 2, 3, 8, 9, 10, 11}
+std::vector<int> parse_cpu_list(const std::string &list) {
+  std::vector<int> cpus;
+  std::stringstream ranges(list);
+  std::string range;
+  while (std::getline(ranges, range, ',')) {
+    int first, last;
+    const char dash = '-';
+    if (range.find(dash) == std::string::npos) {
+      first = last = std::stoi(range);
+    } else {
+      first = std::stoi(range.substr(0, range.find(dash)));
+      last = std::stoi(range.substr(range.find(dash) + 1));
+    }
+    for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+// node holding the page at address, -1 if unknown
+int page_node(const void *address) {
+#if defined(__linux__) && defined(SYS_move_pages)
+  void *page = (void *)address;
+  int status = -1;
+  // without target nodes move_pages only reports where the pages are
+  if (syscall(SYS_move_pages, 0, 1, &page, nullptr, &status, 0) == 0 && status >= 0) return status;
+#endif
+  return -1;
+}
+
+bool pin_thread(std::thread &thread, int cpu) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#else
+  return false;
+#endif
+}
+
+}  // namespace
+
+Topology read_topology() {
+  Topology topology;
+#ifdef __linux__
+  for (int node = 0;; node++) {
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    if (!file) break;
+    std::string list;
+    std::getline(file, list);
+    topology.nodes.push_back(parse_cpu_list(list));
+  }
+#endif
+  if (topology.nodes.empty()) {
+    topology.nodes.emplace_back();
+    for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++)
+      topology.nodes[0].push_back(cpu);
+  }
+  return topology;
+}
+
+ParallelStepper::ParallelStepper(int threads, bool pin) : topology_(read_topology()) {
+  if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+  const int nodes = (int)topology_.nodes.size();
+  for (int worker = 0; worker < threads; worker++) {
+    if (!pin) {
+      cpus_.push_back(-1);
+      continue;
+    }
+    // contiguous groups of workers per node, round robin over the cpus of the node
+    const int node = worker * nodes / threads;
+    const int first_worker = (node * threads + nodes - 1) / nodes;
+    const std::vector<int> &cpus = topology_.nodes[node];
+    cpus_.push_back(cpus.empty() ? -1 : cpus[(worker - first_worker) % cpus.size()]);
+  }
+
+  for (int worker = 0; worker < threads; worker++) {
+    workers_.emplace_back(&ParallelStepper::run, this, worker);
+    if (cpus_[worker] >= 0 && !pin_thread(workers_.back(), cpus_[worker])) cpus_[worker] = -1;
+  }
+}
+
+ParallelStepper::~ParallelStepper() {
+  Board none;
+  dispatch(Job::quit, none);
+  for (auto &worker : workers_) worker.join();
+}
+
+int ParallelStepper::band_begin(const Board &board, int worker) const {
+  // on a row of tiles, the bands flag the tiles of their rows
+  if (worker == threads()) return board.height;
+  return (int)((long long)board.height * worker / threads()) / tile_rows * tile_rows;
+}
+
+void ParallelStepper::dispatch(Job job, Board &board) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  job_ = job;
+  board_ = &board;
+  pending_ = threads();
+  round_++;
+  start_.notify_all();
+  if (job == Job::quit) return;
+  done_.wait(lock, [this] { return pending_ == 0; });
+}
+
+void ParallelStepper::run(int worker) {
+  long long seen = 0;
+  for (;;) {
+    Job job;
+    Board *board;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock, [&] { return round_ != seen; });
+      seen = round_;
+      job = job_;
+      board = board_;
+    }
+    if (job == Job::quit) return;
+
+    const int begin = band_begin(*board, worker);
+    const int end = band_begin(*board, worker + 1);
+    const size_t first = (size_t)begin * board->stride, last = (size_t)end * board->stride;
+    if (job == Job::touch) {
+      std::fill(board->cells.begin() + first, board->cells.begin() + last, 0);
+      std::fill(board->next.begin() + first, board->next.begin() + last, 0);
+    } else {
+      step_rows(board->cells.data(), board->next.data(), board->width, board->height, board->stride, begin, end,
+                board->dirty.data(), board->tiles.data());
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--pending_ == 0) done_.notify_one();
+  }
+}
+
+void ParallelStepper::place(Board &board) { dispatch(Job::touch, board); }
+
+void ParallelStepper::update(Board &board) {
+  dispatch(Job::step, board);
+  board.cells.swap(board.next);
+}
+
+void ParallelStepper::report(const Board &board) const {
+  std::cout << topology_.nodes.size() << " NUMA node(s)" << std::endl;
+  for (size_t node = 0; node < topology_.nodes.size(); node++) {
+    std::cout << "  node " << node << ": " << topology_.nodes[node].size() << " cpus" << std::endl;
+  }
+
+  for (int worker = 0; worker < threads(); worker++) {
+    const int begin = band_begin(board, worker);
+    const int end = band_begin(board, worker + 1);
+    std::cout << "  worker " << worker << " rows " << begin << "-" << end << ", ";
+    if (cpus_[worker] < 0) {
+      std::cout << "not pinned";
+    } else {
+      std::cout << "cpu " << cpus_[worker];
+      for (size_t node = 0; node < topology_.nodes.size(); node++)
+        if (std::count(topology_.nodes[node].begin(), topology_.nodes[node].end(), cpus_[worker]) > 0)
+          std::cout << " node " << node;
+    }
+
+    // sample a few pages of the band
+    const size_t first = (size_t)begin * board.stride, last = (size_t)end * board.stride;
+    std::vector<int> pages_per_node(topology_.nodes.size(), 0);
+    int unknown = 0;
+    for (int sample = 0; sample < 16 && first < last; sample++) {
+      const int node = page_node(board.cells.data() + first + (last - first) * sample / 16);
+      if (node >= 0 && node < (int)pages_per_node.size())
+        pages_per_node[node]++;
+      else
+        unknown++;
+    }
+    std::cout << ", pages on nodes:";
+    for (size_t node = 0; node < pages_per_node.size(); node++) std::cout << " " << pages_per_node[node];
+    if (unknown > 0) std::cout << " (" << unknown << " unknown)";
+    std::cout << std::endl;
+  }
+}
+
+int run_parallel_benchmark(int threads, int width, int height, int generations, uint64_t seed, double density) {
+  const double cells = (double)width * height * generations;
+  std::cout << width << "x" << height << " board, " << generations << " generations" << std::endl;
+
+  Board serial = make_board(width, height);
+  fill_random(serial, seed, density);
+  auto start = std::chrono::steady_clock::now();
+  for (int g = 0; g < generations; g++) update_cells(serial);
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const double serial_rate = cells / elapsed;
+  std::cout << "1 thread:             " << serial_rate << " cells/s" << std::endl;
+
+  int result = 0;
+  for (bool numa_aware : {false, true}) {
+    ParallelStepper stepper(threads, numa_aware);
+    Board board = make_board(width, height);
+    if (numa_aware) {
+      stepper.place(board);
+    } else {
+      // what a plain vector would do: every page touched by the allocating thread
+      std::fill(board.cells.begin(), board.cells.end(), 0);
+      std::fill(board.next.begin(), board.next.end(), 0);
+    }
+    fill_random(board, seed, density);
+
+    start = std::chrono::steady_clock::now();
+    for (int g = 0; g < generations; g++) stepper.update(board);
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << stepper.threads() << (numa_aware ? " pinned, placed:  " : " threads, unplaced: ") << cells / elapsed
+              << " cells/s (" << cells / elapsed / serial_rate << "x)" << std::endl;
+    stepper.report(board);
+    if (board.cells != serial.cells) {
+      std::cout << "ERROR parallel and serial boards differ" << std::endl;
+      result = 1;
+    }
+  }
+  return result;
+}
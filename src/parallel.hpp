@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "life.hpp"
+
+// cpus of each NUMA node, a single node holding every cpu when the system doesn't say
+struct Topology {
+  std::vector<std::vector<int>> nodes;
+};
+
+Topology read_topology();
+
+/**
+ * steps a board with a pool of workers, each owning a band of rows
+ * with pinning, workers are spread evenly over the NUMA nodes, consecutive bands on the same node,
+ * and place() has each worker touch its own band first so its pages are allocated on its node
+ */
+class ParallelStepper {
+ public:
+  // threads = 0: one per core
+  ParallelStepper(int threads, bool pin);
+  ~ParallelStepper();
+  ParallelStepper(const ParallelStepper &) = delete;
+  ParallelStepper &operator=(const ParallelStepper &) = delete;
+
+  int threads() const { return (int)workers_.size(); }
+
+  // to call on a new board before anything else writes to it, clears it
+  void place(Board &board);
+  void update(Board &board);
+
+  // which cpu and node each worker runs on and where the pages of its band ended up
+  void report(const Board &board) const;
+
+ private:
+  enum class Job { touch, step, quit };
+
+  void run(int worker);
+  void dispatch(Job job, Board &board);
+  int band_begin(const Board &board, int worker) const;
+
+  Topology topology_;
+  // cpu of each worker, -1 when not pinned
+  std::vector<int> cpus_;
+  std::vector<std::thread> workers_;
+
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  Job job_ = Job::step;
+  Board *board_ = nullptr;
+  long long round_ = 0;
+  int pending_ = 0;
+};
+
+/**
+ * steps a random board of width * height for `generations` on one thread,
+ * then with workers on a board first touched by one thread, then with pinned workers owning their bands,
+ * checks they agree and prints the topology and cells per second of each
+ */
+int run_parallel_benchmark(int threads, int width, int height, int generations, uint64_t seed, double density);
@@ -0,0 +1,400 @@
+#include "render.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// uniform block of the data changing every frame, std140 layout of the Frame block of the shaders
+struct FrameUniforms {
+  int hovered[2];
+  float origin[2];
+  float zoom;
+  float square;
+  int level;
+  int block_side;
+};
+constexpr unsigned int frame_binding = 0;
+
+constexpr GLfloat white[] = {1.0f, 1.0f, 1.0f, 1.0f};
+constexpr GLfloat black[] = {0.0f, 0.0f, 0.0f, 0.0f};
+constexpr GLfloat grey[] = {.5f, .5f, .5f, 0.8f};
+
+// one byte per cell, row after row, for rows [row_begin, row_end) written at their place in states
+void unpack_states(const Board &board, const GridLayout &layout, unsigned char *states, int row_begin, int row_end) {
+  for (int y = row_begin; y < row_end; y++) {
+    const uint64_t *row = board.cells.data() + (size_t)y * board.stride;
+    unsigned char *out = states + (size_t)y * layout.columns;
+    for (int x = 0; x < layout.columns; x++) out[x] = (row[x / 64] >> (x % 64)) & 1;
+  }
+}
+
+// literal reading back as the same float
+std::string glsl_float(float value) {
+  char literal[32];
+  snprintf(literal, sizeof(literal), "%.9g", value);
+  std::string result = literal;
+  if (result.find_first_of(".e") == std::string::npos) result += ".0";
+  return result;
+}
+
+std::string glsl_vec(const char *type, std::initializer_list<float> values) {
+  std::string result = std::string(type) + "(";
+  for (float value : values) result += (result.back() == '(' ? "" : ", ") + glsl_float(value);
+  return result + ")";
+}
+
+std::string glsl_ivec2(int x, int y) { return "ivec2(" + std::to_string(x) + ", " + std::to_string(y) + ")"; }
+
+std::string glsl_color(const GLfloat *color) { return glsl_vec("vec4", {color[0], color[1], color[2], color[3]}); }
+
+// the palette of frame.glsl
+void add_colors(ShaderDefines &defines) {
+  defines.emplace_back("DEAD_COLOR", glsl_color(white));
+  defines.emplace_back("ALIVE_COLOR", glsl_color(black));
+  defines.emplace_back("HOVERED_COLOR", glsl_color(grey));
+}
+
+// the gutters are dropped once they would be thinner than half a pixel or so
+double square_pixels(const GridLayout &layout, const Camera &camera) {
+  if (camera.zoom < 4) return camera.zoom;
+  return camera.zoom * layout.square_side / (layout.square_side + layout.square_gutter);
+}
+
+void update_frame(UniformBuffer &frame, const GridLayout &layout, const Camera &camera, int hovered_x, int hovered_y,
+                  int level) {
+  const bool hovering = hovered_x >= 0 && hovered_y >= 0 && hovered_x < layout.columns && hovered_y < layout.rows;
+  const FrameUniforms uniforms = {{hovering ? hovered_x : -1, hovering ? hovered_y : -1},
+                                  {(float)(camera.center_x * camera.zoom), (float)(camera.center_y * camera.zoom)},
+                                  (float)camera.zoom,
+                                  (float)square_pixels(layout, camera),
+                                  level,
+                                  level >= 0 ? DensityPyramid::block_side(level) : 0};
+  frame.update(&uniforms, sizeof(uniforms));
+}
+
+}  // namespace
+
+Camera default_camera(const GridLayout &layout) {
+  const int step = layout.square_side + layout.square_gutter;
+  // the center on a cell corner, like the fixed grid had
+  if (layout.columns * step <= layout.window_width && layout.rows * step <= layout.window_height)
+    return {(double)(layout.columns / 2), (double)(layout.rows / 2), (double)step};
+  const double fit =
+      std::min((double)layout.window_width / layout.columns, (double)layout.window_height / layout.rows);
+  return {layout.columns * .5, layout.rows * .5, std::max(fit, min_zoom)};
+}
+
+void zoom_camera(Camera &camera, const GridLayout &layout, double factor, double x, double y) {
+  const double zoom = std::min(std::max(camera.zoom * factor, min_zoom), max_zoom);
+  const double from_center_x = x - layout.window_width / 2;
+  const double from_center_y = y - layout.window_height / 2;
+  camera.center_x += from_center_x / camera.zoom - from_center_x / zoom;
+  camera.center_y += from_center_y / camera.zoom - from_center_y / zoom;
+  camera.zoom = zoom;
+}
+
+void pan_camera(Camera &camera, double dx, double dy) {
+  camera.center_x -= dx / camera.zoom;
+  camera.center_y -= dy / camera.zoom;
+}
+
+void camera_cell(const Camera &camera, const GridLayout &layout, double x, double y, int *cell_x, int *cell_y) {
+  // the same pixel to cell mapping as grid.fs
+  const double board_x = std::floor(x) - layout.window_width / 2 + camera.center_x * camera.zoom;
+  const double board_y = std::floor(y) - layout.window_height / 2 + camera.center_y * camera.zoom;
+  *cell_x = (int)std::min(std::max(std::floor(board_x / camera.zoom), -1.0), (double)layout.columns);
+  *cell_y = (int)std::min(std::max(std::floor(board_y / camera.zoom), -1.0), (double)layout.rows);
+}
+
+ProgramSpec InstancedRenderer::program(const GridLayout &layout) {
+  const float half_width = layout.window_width * .5f;
+  const float half_height = layout.window_height * .5f;
+  const float half_side = layout.square_side * .5f;
+  const int step = layout.square_side + layout.square_gutter;
+  ShaderDefines defines = {
+      {"GRID_SIZE", glsl_ivec2(layout.columns, layout.rows)},
+      {"CELL_STEP", glsl_vec("vec2", {step / half_width, step / half_height})},
+      {"HALF_SQUARE", glsl_vec("vec2", {half_side / half_width, half_side / half_height})},
+  };
+  add_colors(defines);
+  return {{"vertex.vs", "fragment.fs"}, defines};
+}
+
+InstancedRenderer::InstancedRenderer(const GridLayout &layout)
+    : layout_(layout),
+      program_(program(layout)),
+      frame_(sizeof(FrameUniforms), frame_binding),
+      states_(GL_ARRAY_BUFFER, (size_t)layout.columns * layout.rows) {
+  camera_ = default_camera(layout);
+  const float half_width = layout.window_width * .5f;
+  const float half_height = layout.window_height * .5f;
+  const float half_side = layout.square_side * .5f;
+  float vertices[] = {
+      -half_side / half_width, half_side / half_height,  .0f,  // top left
+      half_side / half_width,  half_side / half_height,  .0f,  // top right
+      -half_side / half_width, -half_side / half_height, .0f,  // bottom left
+      half_side / half_width,  -half_side / half_height, .0f,  // bottom right
+  };
+  unsigned int indices[] = {0, 1, 2, 1, 2, 3};
+
+  glGenVertexArrays(1, &vao_);
+  glBindVertexArray(vao_);
+
+  glGenBuffers(1, &quad_vbo_);
+  glBindBuffer(GL_ARRAY_BUFFER, quad_vbo_);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+  glEnableVertexAttribArray(0);
+
+  glGenBuffers(1, &ebo_);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+  // cell states, one byte per instance, pointed at the segment written each frame
+  glVertexAttribDivisor(1, 1);
+  glEnableVertexAttribArray(1);
+  glBindVertexArray(0);
+
+  if (!program_.valid()) {
+    std::cout << "Error while parsing/compiling shaders" << std::endl;
+    return;
+  }
+  setup_program();
+}
+
+void InstancedRenderer::setup_program() {
+  // everything but the hovered cell is compiled in
+  program_.bind_block("Frame", frame_binding);
+}
+
+void InstancedRenderer::reload_shaders(const std::vector<std::string> &changed) {
+  if (program_.reload(changed)) setup_program();
+}
+
+InstancedRenderer::~InstancedRenderer() {
+  glDeleteVertexArrays(1, &vao_);
+  glDeleteBuffers(1, &quad_vbo_);
+  glDeleteBuffers(1, &ebo_);
+}
+
+void InstancedRenderer::draw(const Board &board, int hovered_x, int hovered_y) {
+  unpack_states(board, layout_, states_.map(), 0, layout_.rows);
+  const size_t offset = states_.unmap();
+  uploaded_bytes_ += (long long)layout_.columns * layout_.rows;
+
+  update_frame(frame_, layout_, camera_, hovered_x, hovered_y, -1);
+  program_.use();
+  glBindVertexArray(vao_);
+  glBindBuffer(GL_ARRAY_BUFFER, states_.buffer());
+  glVertexAttribIPointer(1, 1, GL_UNSIGNED_BYTE, 1, (void*)offset);
+  glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, layout_.columns * layout_.rows);
+  glBindVertexArray(0);
+  states_.fence();
+}
+
+ProgramSpec TextureRenderer::program(const GridLayout &layout, bool packed) {
+  ShaderDefines defines = {
+      {"BIT_PACKED", packed ? "true" : "false"},
+      {"GRID_SIZE", glsl_ivec2(layout.columns, layout.rows)},
+      {"WINDOW_SIZE", glsl_ivec2(layout.window_width, layout.window_height)},
+  };
+  add_colors(defines);
+  return {{"grid.vs", "grid.fs"}, defines};
+}
+
+TextureRenderer::TextureRenderer(const GridLayout &layout, bool packed)
+    : layout_(layout),
+      program_(program(layout, packed)),
+      frame_(sizeof(FrameUniforms), frame_binding),
+      packed_(packed),
+      row_bytes_(packed ? (layout.columns + 63) / 64 * sizeof(uint64_t) : layout.columns),
+      stale_(layout.rows, 1),
+      states_(GL_PIXEL_UNPACK_BUFFER, row_bytes_ * layout.rows) {
+  camera_ = default_camera(layout);
+  // the quad comes from gl_VertexID, core profile still wants a vertex array bound
+  glGenVertexArrays(1, &vao_);
+
+  glGenTextures(1, &texture_);
+  glBindTexture(GL_TEXTURE_2D, texture_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  if (packed)
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32UI, (layout.columns + 63) / 64, layout.rows, 0, GL_RG_INTEGER,
+                 GL_UNSIGNED_INT, NULL);
+  else
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, layout.columns, layout.rows, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, NULL);
+
+  if (!program_.valid()) {
+    std::cout << "Error while parsing/compiling shaders" << std::endl;
+    return;
+  }
+  setup_program();
+}
+
+void TextureRenderer::setup_program() {
+  program_.use();
+  program_.set("cells", 0);
+  program_.set("density", 1);
+  program_.bind_block("Frame", frame_binding);
+}
+
+void TextureRenderer::reload_shaders(const std::vector<std::string> &changed) {
+  if (program_.reload(changed)) setup_program();
+}
+
+TextureRenderer::~TextureRenderer() {
+  glDeleteVertexArrays(1, &vao_);
+  glDeleteTextures(1, &texture_);
+  glDeleteTextures(DensityPyramid::levels, density_textures_);
+}
+
+void TextureRenderer::set_density(const DensityPyramid *density) {
+  density_ = density;
+  glDeleteTextures(DensityPyramid::levels, density_textures_);
+  for (int level = 0; level < DensityPyramid::levels; level++) {
+    density_textures_[level] = 0;
+    density_stale_[level].clear();
+  }
+  if (density == nullptr) return;
+
+  glGenTextures(DensityPyramid::levels, density_textures_);
+  for (int level = 0; level < DensityPyramid::levels; level++) {
+    glBindTexture(GL_TEXTURE_2D, density_textures_[level]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, density->columns(level), density->rows(level), 0, GL_RED_INTEGER,
+                 GL_UNSIGNED_INT, NULL);
+    density_stale_[level].assign(density->rows(level), 1);
+  }
+}
+
+void TextureRenderer::visible_rows(int *begin, int *end) const {
+  const double top = camera_.center_y - layout_.window_height / 2 / camera_.zoom;
+  const double bottom = top + layout_.window_height / camera_.zoom;
+  *begin = (int)std::min(std::max(std::floor(top), 0.0), (double)layout_.rows);
+  *end = (int)std::min(std::max(std::floor(bottom) + 1, (double)*begin), (double)layout_.rows);
+}
+
+void TextureRenderer::draw(const Board &board, int hovered_x, int hovered_y) {
+  for (int y = 0; y < layout_.rows; y++) stale_[y] |= board.dirty[y];
+  if (density_ != nullptr)
+    for (int level = 0; level < DensityPyramid::levels; level++)
+      for (int y = 0; y < density_->rows(level); y++) density_stale_[level][y] |= density_->dirty(level)[y];
+
+  // the smallest blocks covering at least a pixel once cells are smaller than one
+  int level = -1;
+  if (density_ != nullptr && camera_.zoom < 1) {
+    level = 0;
+    while (level + 1 < DensityPyramid::levels && DensityPyramid::block_side(level) * camera_.zoom < 1) level++;
+  }
+
+  int begin, end;
+  visible_rows(&begin, &end);
+  if (level >= 0) {
+    upload_density(level, begin, end);
+    draw_level(texture_, level, hovered_x, hovered_y);
+  } else {
+    const bool streamed = upload_cells(board, begin, end);
+    draw_level(texture_, -1, hovered_x, hovered_y);
+    if (streamed) states_.fence();
+  }
+}
+
+bool TextureRenderer::upload_cells(const Board &board, int begin, int end) {
+  // runs of changed rows, each unpacked at its place in the segment and uploaded with its own call
+  std::vector<std::pair<int, int>> runs;
+  for (int y = begin; y < end; y++) {
+    if (!stale_[y]) continue;
+    stale_[y] = 0;
+    if (!runs.empty() && runs.back().second == y)
+      runs.back().second++;
+    else
+      runs.emplace_back(y, y + 1);
+  }
+  if (runs.empty()) return false;
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, texture_);
+  unsigned char *states = states_.map();
+  for (const auto &run : runs) {
+    if (packed_)
+      // the words as they are, assumes a little endian host for the low half to land in r
+      std::memcpy(states + run.first * row_bytes_, board.cells.data() + (size_t)run.first * board.stride,
+                  (run.second - run.first) * row_bytes_);
+    else
+      unpack_states(board, layout_, states, run.first, run.second);
+  }
+  const size_t offset = states_.unmap();
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, states_.buffer());
+  for (const auto &run : runs) {
+    void *first = (void*)(offset + run.first * row_bytes_);
+    if (packed_)
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, run.first, (layout_.columns + 63) / 64, run.second - run.first,
+                      GL_RG_INTEGER, GL_UNSIGNED_INT, first);
+    else
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, run.first, layout_.columns, run.second - run.first, GL_RED_INTEGER,
+                      GL_UNSIGNED_BYTE, first);
+    uploaded_bytes_ += (long long)(run.second - run.first) * row_bytes_;
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  return true;
+}
+
+void TextureRenderer::upload_density(int level, int begin, int end) {
+  const int side = DensityPyramid::block_side(level);
+  const int columns = density_->columns(level);
+  const int last = std::min((end + side - 1) / side, density_->rows(level));
+  std::vector<unsigned char> &stale = density_stale_[level];
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, density_textures_[level]);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  for (int y = begin / side; y < last;) {
+    if (!stale[y]) {
+      y++;
+      continue;
+    }
+    int run_end = y;
+    while (run_end < last && stale[run_end]) stale[run_end++] = 0;
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, columns, run_end - y, GL_RED_INTEGER, GL_UNSIGNED_INT,
+                    density_->counts(level).data() + (size_t)y * columns);
+    uploaded_bytes_ += (long long)(run_end - y) * columns * sizeof(uint32_t);
+    y = run_end;
+  }
+}
+
+void TextureRenderer::draw_texture(unsigned int texture, int hovered_x, int hovered_y) {
+  draw_level(texture, -1, hovered_x, hovered_y);
+}
+
+void TextureRenderer::draw_level(unsigned int texture, int level, int hovered_x, int hovered_y) {
+  if (level >= 0) {
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, density_textures_[level]);
+  }
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  update_frame(frame_, layout_, camera_, hovered_x, hovered_y, level);
+  program_.use();
+  glBindVertexArray(vao_);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  glBindVertexArray(0);
+}
+
+std::unique_ptr<Renderer> create_renderer(const char *name, const GridLayout &layout) {
+  const std::string renderer = name != NULL ? name : "";
+  if (renderer == "texture") return std::unique_ptr<Renderer>(new TextureRenderer(layout, false));
+  if (renderer == "packed") return std::unique_ptr<Renderer>(new TextureRenderer(layout, true));
+  return std::unique_ptr<Renderer>(new InstancedRenderer(layout));
+}
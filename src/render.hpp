@@ -0,0 +1,149 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "density.hpp"
+#include "life.hpp"
+#include "shader.hpp"
+#include "stream.hpp"
+
+// where the cells are drawn in the window, in pixels
+struct GridLayout {
+  int columns;
+  int rows;
+  int square_side;
+  int square_gutter;
+  int window_width;
+  int window_height;
+};
+
+// what the window shows of the board: the point of the board at the window center, in cells, and pixels per cell
+struct Camera {
+  double center_x;
+  double center_y;
+  double zoom;
+};
+constexpr double min_zoom = 1.0 / 512;
+constexpr double max_zoom = 64;
+
+// the grid of the layout as it always was drawn, or the whole board when it doesn't fit the window that way
+Camera default_camera(const GridLayout &layout);
+// zooms by factor, clamped to [min_zoom, max_zoom], keeping the board point under window pixel (x, y) in place
+void zoom_camera(Camera &camera, const GridLayout &layout, double factor, double x, double y);
+// moves the board by (dx, dy) window pixels
+void pan_camera(Camera &camera, double dx, double dy);
+// cell under window pixel (x, y), y going down, which can be outside the board
+void camera_cell(const Camera &camera, const GridLayout &layout, double x, double y, int *cell_x, int *cell_y);
+
+class Renderer {
+ public:
+  virtual ~Renderer() = default;
+  // hovered cell is highlighted, pass -1 for none
+  virtual void draw(const Board &board, int hovered_x, int hovered_y) = 0;
+  // rebuilds the programs using one of the changed shaders, see ShaderProgram::reload
+  virtual void reload_shaders(const std::vector<std::string> &changed) = 0;
+
+  // cell state bytes sent to the GPU since the renderer was created
+  long long uploaded_bytes() const { return uploaded_bytes_; }
+
+  // whether the renderer draws through a camera, the others always show the default one
+  virtual bool movable() const { return false; }
+  void set_camera(const Camera &camera) { camera_ = camera; }
+  // live counts drawn instead of the cells once they get smaller than a pixel, null to always draw cells
+  virtual void set_density(const DensityPyramid * /*density*/) {}
+
+ protected:
+  long long uploaded_bytes_ = 0;
+  Camera camera_ = {0, 0, 1};
+};
+
+/**
+ * draws every cell in a single instanced draw call
+ * the state of each cell is a per instance byte streamed through a ring of buffers, the vertex shader places the square
+ * from gl_InstanceID and picks its color
+ */
+class InstancedRenderer : public Renderer {
+ public:
+  // needs a current GL context
+  explicit InstancedRenderer(const GridLayout &layout);
+  ~InstancedRenderer() override;
+  // shaders specialized with the layout and the colors, for compile_programs
+  static ProgramSpec program(const GridLayout &layout);
+  InstancedRenderer(const InstancedRenderer &) = delete;
+  InstancedRenderer &operator=(const InstancedRenderer &) = delete;
+
+  void draw(const Board &board, int hovered_x, int hovered_y) override;
+  void reload_shaders(const std::vector<std::string> &changed) override;
+
+ private:
+  // uniforms fixed for the whole run
+  void setup_program();
+
+  GridLayout layout_;
+  ShaderProgram program_;
+  UniformBuffer frame_;
+  unsigned int vao_, quad_vbo_, ebo_;
+  // one byte per cell, unpacked from the board straight into the buffer
+  StreamBuffer states_;
+};
+
+/**
+ * uploads the board as a one byte per cell texture and draws a single full screen quad,
+ * the fragment shader finds the cell under each pixel, leaving gutters and the margin untouched
+ * the cost doesn't depend on the number of cells but on the number of pixels
+ * only the rows flagged in board.dirty are uploaded, the texture keeps the others, and only once they are on screen
+ * packed uploads the board words as they are, two 32 bit channels per word, and the fragment shader
+ * extracts the bit of its cell, 8 times less data than a byte per cell and no unpacking on the CPU
+ * zoomed out past a cell per pixel, the pixels show the density of the smallest blocks of the pyramid
+ * covering one (see set_density), and only their counts are uploaded
+ */
+class TextureRenderer : public Renderer {
+ public:
+  // needs a current GL context
+  TextureRenderer(const GridLayout &layout, bool packed);
+  ~TextureRenderer() override;
+  static ProgramSpec program(const GridLayout &layout, bool packed);
+  TextureRenderer(const TextureRenderer &) = delete;
+  TextureRenderer &operator=(const TextureRenderer &) = delete;
+
+  void draw(const Board &board, int hovered_x, int hovered_y) override;
+  // draws cells already on the GPU, a texture of the layout the renderer uses (see FragmentLife), at any zoom
+  void draw_texture(unsigned int texture, int hovered_x, int hovered_y);
+  void reload_shaders(const std::vector<std::string> &changed) override;
+
+  bool movable() const override { return true; }
+  // needs the pyramid of the board drawn, kept up to date by the caller
+  void set_density(const DensityPyramid *density) override;
+
+ private:
+  void setup_program();
+  // level of density drawn, -1 for cells
+  void draw_level(unsigned int texture, int level, int hovered_x, int hovered_y);
+  // [begin, end) rows of cells the camera shows
+  void visible_rows(int *begin, int *end) const;
+  // false when every row of the range was up to date, nothing was streamed
+  bool upload_cells(const Board &board, int begin, int end);
+  void upload_density(int level, int begin, int end);
+
+  GridLayout layout_;
+  ShaderProgram program_;
+  UniformBuffer frame_;
+  bool packed_;
+  // bytes of a texture row
+  size_t row_bytes_;
+  unsigned int vao_, texture_;
+  // rows of the texture behind the board, all of them until the first draws upload them
+  std::vector<unsigned char> stale_;
+  // unpack buffer the texture is updated from
+  StreamBuffer states_;
+
+  const DensityPyramid *density_ = nullptr;
+  // one GL_R32UI texture of counts per level, and their rows of blocks behind the pyramid
+  unsigned int density_textures_[DensityPyramid::levels] = {};
+  std::vector<unsigned char> density_stale_[DensityPyramid::levels];
+};
+
+// "instanced", "texture" or "packed", instanced for anything else
+std::unique_ptr<Renderer> create_renderer(const char *name, const GridLayout &layout);
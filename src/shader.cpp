@@ -1,10 +1,36 @@
 #include "shader.hpp"
 
 #include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include <helpers/Shaders.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::string program_cache;
+std::string shader_directory;
+ProgramStats stats;
 
 std::string read_file(const char *path) {
   // ensure ifstream objects can throw exceptions:
@@ -23,62 +49,438 @@ std::string read_file(const char *path) {
   }
 }
 
-void checkCompileErrors(GLuint shader, std::string type) {
+// file of the shader directory when there's one, the source embedded in the executable otherwise
+std::string shader_source(const char *name) {
+  if (!shader_directory.empty()) {
+    const std::string path = shader_directory + "/" + name;
+    std::string source = read_file(path.c_str());
+    if (source != "") std::cout << path << " SUCCESSFULLY READ" << std::endl;
+    return source;
+  }
+  for (const EmbeddedShader &shader : embedded_shaders)
+    if (shader.name == name) return std::string(shader.source);
+  std::cout << "ERROR no shader " << name << " embedded" << std::endl;
+  return "";
+}
+
+// index of the file in files, its source string number in the #line directives and the driver's errors
+std::string source_number(const std::vector<std::string> &files, const std::string &name) {
+  return std::to_string(std::find(files.begin(), files.end(), name) - files.begin());
+}
+
+/**
+ * source with its #include "file" lines replaced by the files, recursively, files gets every name read
+ * #line directives keep the line numbers of each file, so errors point at the line of the file edited
+ */
+std::string expand_includes(const std::string &name, std::vector<std::string> &files, int depth = 0) {
+  if (depth > 16) {
+    std::cout << "ERROR #include nested too deep in " << name << std::endl;
+    return "";
+  }
+  if (std::find(files.begin(), files.end(), name) == files.end()) files.push_back(name);
+  const std::string source = shader_source(name.c_str());
+  if (source == "") return "";
+
+  std::istringstream lines(source);
+  // the top file starts with #version, which no directive can come before
+  std::string expanded = depth > 0 ? "#line 1 " + source_number(files, name) + "\n" : "", line;
+  int number = 0;
+  while (std::getline(lines, line)) {
+    number++;
+    const size_t directive = line.find_first_not_of(" \t");
+    if (directive != std::string::npos && line.compare(directive, 8, "#include") == 0) {
+      const size_t open = line.find('"', directive);
+      const size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+      if (close == std::string::npos) {
+        std::cout << "ERROR malformed #include in " << name << ": " << line << std::endl;
+        return "";
+      }
+      const std::string included = expand_includes(line.substr(open + 1, close - open - 1), files, depth + 1);
+      if (included == "") return "";
+      expanded += included + "#line " + std::to_string(number + 1) + " " + source_number(files, name) + "\n";
+    } else {
+      expanded += line + "\n";
+    }
+  }
+  return expanded;
+}
+
+/**
+ * shader ready to compile, the defines go after #version which has to stay the first directive
+ * followed by a #line giving the next line its number in the file and the file its source number
+ */
+std::string preprocess(const std::string &name, const ShaderDefines &defines, std::vector<std::string> &files) {
+  std::string source = expand_includes(name, files);
+  if (source == "") return source;
+  std::string lines;
+  for (const auto &define : defines) lines += "#define " + define.first + " " + define.second + "\n";
+  const size_t version = source.find("#version");
+  const size_t end = version == std::string::npos ? version : source.find('\n', version);
+  if (end == std::string::npos) return lines + "#line 1 " + source_number(files, name) + "\n" + source;
+  const long version_line = std::count(source.begin(), source.begin() + end, '\n') + 1;
+  lines += "#line " + std::to_string(version_line + 1) + " " + source_number(files, name) + "\n";
+  return source.insert(end + 1, lines);
+}
+
+// 64 bit FNV-1a
+uint64_t hash_bytes(uint64_t hash, const std::string &bytes) {
+  for (unsigned char c : bytes) hash = (hash ^ c) * 0x100000001b3;
+  // keeps "ab" + "c" apart from "a" + "bc"
+  return (hash ^ 0xff) * 0x100000001b3;
+}
+
+// cache file of the sources for the current driver, empty when there's no cache
+std::string binary_path(const std::vector<std::string> &sources) {
+  if (program_cache.empty() || !GLAD_GL_VERSION_4_1) return "";
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  if (formats == 0) return "";
+
+  uint64_t hash = 0xcbf29ce484222325;
+  for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) hash = hash_bytes(hash, (const char *)glGetString(name));
+  for (const std::string &source : sources) hash = hash_bytes(hash, source);
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)hash);
+  return program_cache + "/" + name;
+}
+
+// program whose compilation and link are issued, its status not queried yet
+struct PendingProgram {
+  ProgramSpec spec;
+  // shaders and the files they include
+  std::vector<std::string> files;
+  GLuint program = 0;
+  // compiled shaders, none when the program was loaded from the cache
+  std::vector<GLuint> shaders;
+  // cache file to write once linked
+  std::string binary;
+};
+
+// started by compile_programs, waiting for the ShaderProgram made of the same shaders
+std::vector<PendingProgram> pending;
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool ends_with(const std::string &name, const char *suffix) {
+  const size_t length = strlen(suffix);
+  return name.size() >= length && name.compare(name.size() - length, length, suffix) == 0;
+}
+
+GLenum shader_type(const std::string &name) {
+  if (ends_with(name, ".vs")) return GL_VERTEX_SHADER;
+  if (ends_with(name, ".comp")) return GL_COMPUTE_SHADER;
+  return GL_FRAGMENT_SHADER;
+}
+
+// linked program saved by save_binary, 0 when there's none or the driver rejects it
+GLuint load_binary(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return 0;
+  GLenum format = 0;
+  if (!file.read((char *)&format, sizeof(format))) return 0;
+  std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  if (binary.empty()) return 0;
+
+  GLuint program = glCreateProgram();
+  glProgramBinary(program, format, binary.data(), (GLsizei)binary.size());
   GLint success;
-  GLchar infoLog[1024];
-  if (type != "PROGRAM") {
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (!success) {
+    // made by another driver version, compiled again and overwritten
+    glDeleteProgram(program);
+    return 0;
+  }
+  return program;
+}
+
+void save_binary(GLuint program, const std::string &path) {
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length == 0) return;
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  glGetProgramBinary(program, length, NULL, &format, binary.data());
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write((const char *)&format, sizeof(format));
+  file.write(binary.data(), binary.size());
+  if (!file) std::cout << "ERROR while writing " << path << std::endl;
+}
+
+/**
+ * reads the sources and loads the program from the cache or issues the compilation of its shaders and the link,
+ * without asking the driver for any status, which would wait for it
+ */
+PendingProgram start_program(const ProgramSpec &spec) {
+  const auto start = std::chrono::steady_clock::now();
+  PendingProgram program;
+  program.spec = spec;
+  std::vector<std::string> sources;
+  for (const std::string &name : spec.shaders) {
+    sources.push_back(preprocess(name, spec.defines, program.files));
+    if (sources.back() == "") return program;
+  }
+
+  program.binary = binary_path(sources);
+  if (!program.binary.empty()) program.program = load_binary(program.binary);
+  if (program.program == 0) {
+    for (size_t i = 0; i < sources.size(); i++) {
+      const char *code = sources[i].c_str();
+      program.shaders.push_back(glCreateShader(shader_type(spec.shaders[i])));
+      glShaderSource(program.shaders.back(), 1, &code, NULL);
+      glCompileShader(program.shaders.back());
+    }
+    program.program = glCreateProgram();
+    for (GLuint shader : program.shaders) glAttachShader(program.program, shader);
+    if (!program_cache.empty() && GLAD_GL_VERSION_4_1)
+      glProgramParameteri(program.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program.program);
+  }
+  stats.seconds += seconds_since(start);
+  return program;
+}
+
+// waits for the driver and prints the compile and link errors, 0 if the program isn't usable
+GLuint finish_program(PendingProgram &program) {
+  if (program.program == 0) return 0;
+  if (program.shaders.empty()) {
+    stats.cached++;
+    return program.program;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  bool compiled = true;
+  for (size_t i = 0; i < program.shaders.size(); i++) {
+    GLint success;
+    glGetShaderiv(program.shaders[i], GL_COMPILE_STATUS, &success);
     if (!success) {
-      glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-      std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n"
+      GLchar infoLog[1024];
+      glGetShaderInfoLog(program.shaders[i], 1024, NULL, infoLog);
+      // errors start with the source number of the file, see expand_includes
+      std::cout << "ERROR::SHADER_COMPILATION_ERROR of " << program.spec.shaders[i] << ", sources";
+      for (size_t file = 0; file < program.files.size(); file++)
+        std::cout << " " << file << ": " << program.files[file];
+      std::cout << "\n"
                 << infoLog << "\n -- ---------------\n"
                 << std::endl;
+      compiled = false;
     }
+  }
+  GLint linked = 0;
+  if (compiled) glGetProgramiv(program.program, GL_LINK_STATUS, &linked);
+  if (compiled && !linked) {
+    GLchar infoLog[1024];
+    glGetProgramInfoLog(program.program, 1024, NULL, infoLog);
+    std::cout << "ERROR::PROGRAM_LINKING_ERROR\n" << infoLog << "\n -- ---------------\n" << std::endl;
+  }
+  // delete the shaders as they're linked into our program now and no longer necessary
+  for (GLuint shader : program.shaders) glDeleteShader(shader);
+
+  if (!linked) {
+    glDeleteProgram(program.program);
+    return 0;
+  }
+  if (!program.binary.empty()) save_binary(program.program, program.binary);
+  stats.compiled++;
+  stats.seconds += seconds_since(start);
+  return program.program;
+}
+
+}  // namespace
+
+void set_program_cache(const std::string &directory) {
+  program_cache = directory;
+  if (directory.empty()) return;
+#ifdef _WIN32
+  _mkdir(directory.c_str());
+#else
+  mkdir(directory.c_str(), 0755);
+#endif
+}
+
+void set_shader_directory(const std::string &directory) { shader_directory = directory; }
+
+void enable_parallel_compile(void *max_shader_compiler_threads) {
+  // programs are still compiled in a batch, only without threads of the driver
+  if (max_shader_compiler_threads == nullptr) return;
+  // GL_KHR_parallel_shader_compile, all the threads the driver wants
+  ((void(APIENTRYP)(GLuint))max_shader_compiler_threads)(0xFFFFFFFF);
+}
+
+bool operator==(const ProgramSpec &a, const ProgramSpec &b) {
+  return a.shaders == b.shaders && a.defines == b.defines;
+}
+
+void compile_programs(const std::vector<ProgramSpec> &programs) {
+  for (const ProgramSpec &spec : programs) pending.push_back(start_program(spec));
+}
+
+void discard_pending_programs() {
+  for (PendingProgram &program : pending) {
+    for (GLuint shader : program.shaders) glDeleteShader(shader);
+    if (program.program != 0) glDeleteProgram(program.program);
+  }
+  pending.clear();
+}
+
+ProgramStats program_stats() { return stats; }
+
+ShaderProgram::ShaderProgram(const ProgramSpec &spec) : spec_(spec) { build(); }
+
+ShaderProgram::ShaderProgram(ShaderProgram &&other) noexcept { swap(other); }
+
+ShaderProgram &ShaderProgram::operator=(ShaderProgram other) noexcept {
+  swap(other);
+  return *this;
+}
+
+ShaderProgram::~ShaderProgram() {
+  if (id_ != 0) glDeleteProgram(id_);
+}
+
+void ShaderProgram::swap(ShaderProgram &other) noexcept {
+  std::swap(id_, other.id_);
+  std::swap(spec_, other.spec_);
+  files_.swap(other.files_);
+  uniforms_.swap(other.uniforms_);
+  blocks_.swap(other.blocks_);
+}
+
+void ShaderProgram::build() {
+  PendingProgram program;
+  auto started =
+      std::find_if(pending.begin(), pending.end(), [&](const PendingProgram &other) { return other.spec == spec_; });
+  if (started != pending.end()) {
+    program = std::move(*started);
+    pending.erase(started);
   } else {
-    glGetProgramiv(shader, GL_LINK_STATUS, &success);
-    if (!success) {
-      glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-      std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n"
-                << infoLog << "\n -- ---------------\n"
-                << std::endl;
+    program = start_program(spec_);
+  }
+  files_ = program.files;
+  id_ = finish_program(program);
+  if (id_ != 0) find_uniforms();
+}
+
+void ShaderProgram::find_uniforms() {
+  GLint count_uniforms = 0, max_length = 0;
+  glGetProgramiv(id_, GL_ACTIVE_UNIFORMS, &count_uniforms);
+  glGetProgramiv(id_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+  std::vector<GLchar> name(max_length + 1);
+  for (GLint i = 0; i < count_uniforms; i++) {
+    GLint size;
+    GLenum type;
+    glGetActiveUniform(id_, i, (GLsizei)name.size(), NULL, &size, &type, name.data());
+    // uniforms of blocks have no location
+    const GLint location = glGetUniformLocation(id_, name.data());
+    if (location == -1) continue;
+    std::string uniform = name.data();
+    // arrays are reported as name[0]
+    if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0) uniform.resize(uniform.size() - 3);
+    uniforms_[uniform] = location;
+  }
+
+  GLint count_blocks = 0;
+  glGetProgramiv(id_, GL_ACTIVE_UNIFORM_BLOCKS, &count_blocks);
+  glGetProgramiv(id_, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_length);
+  name.resize(max_length + 1);
+  for (GLint i = 0; i < count_blocks; i++) {
+    glGetActiveUniformBlockName(id_, i, (GLsizei)name.size(), NULL, name.data());
+    blocks_[name.data()] = i;
+  }
+}
+
+void ShaderProgram::use() const { glUseProgram(id_); }
+
+int ShaderProgram::uniform(const std::string &name) const {
+  auto found = uniforms_.find(name);
+  return found == uniforms_.end() ? -1 : found->second;
+}
+
+void ShaderProgram::set(const std::string &name, int value) const { glUniform1i(uniform(name), value); }
+
+void ShaderProgram::set(const std::string &name, int x, int y) const { glUniform2i(uniform(name), x, y); }
+
+void ShaderProgram::set(const std::string &name, float x, float y) const { glUniform2f(uniform(name), x, y); }
+
+void ShaderProgram::set_vec4(const std::string &name, const float *value) const {
+  glUniform4fv(uniform(name), 1, value);
+}
+
+bool ShaderProgram::bind_block(const std::string &name, unsigned int binding) const {
+  auto found = blocks_.find(name);
+  if (found == blocks_.end()) return false;
+  glUniformBlockBinding(id_, found->second, binding);
+  return true;
+}
+
+bool ShaderProgram::reload(const std::vector<std::string> &changed) {
+  bool stale = false;
+  for (const std::string &file : files_)
+    if (std::find(changed.begin(), changed.end(), file) != changed.end()) stale = true;
+  if (!stale) return false;
+
+  ShaderProgram program(spec_);
+  if (!program.valid()) {
+    // still watching the files of the previous build, failed includes included
+    for (const std::string &file : program.files_)
+      if (std::find(files_.begin(), files_.end(), file) == files_.end()) files_.push_back(file);
+    std::cout << "ERROR " << spec_.shaders.back() << " not reloaded, keeping the previous program" << std::endl;
+    return false;
+  }
+  swap(program);
+  std::cout << spec_.shaders.back() << " reloaded" << std::endl;
+  return true;
+}
+
+ShaderWatcher::ShaderWatcher(const std::string &directory) {
+#ifdef __linux__
+  fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  // editors either write the file in place or rename a new one over it
+  if (fd_ == -1 || inotify_add_watch(fd_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) == -1)
+    std::cout << "ERROR can't watch " << directory << " for shader changes" << std::endl;
+#else
+  std::cout << "ERROR watching " << directory << " for shader changes needs inotify (Linux)" << std::endl;
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher() {
+#ifdef __linux__
+  if (fd_ != -1) close(fd_);
+#endif
+}
+
+std::vector<std::string> ShaderWatcher::changed() {
+  std::vector<std::string> names;
+#ifdef __linux__
+  if (fd_ == -1) return names;
+  alignas(inotify_event) char events[4096];
+  ssize_t length;
+  while ((length = read(fd_, events, sizeof(events))) > 0) {
+    for (ssize_t i = 0; i < length;) {
+      const inotify_event *event = (const inotify_event *)(events + i);
+      if (event->len > 0 && std::find(names.begin(), names.end(), event->name) == names.end())
+        names.push_back(event->name);
+      i += sizeof(inotify_event) + event->len;
     }
   }
+#endif
+  return names;
 }
 
-int create_shader_program(const char *vertex_path, const char *fragment_path) {
-  std::string v_code = read_file(vertex_path);
-  if (v_code == "") return -1;
-  std::cout << vertex_path << " SUCCESSFULLY READ" << std::endl;
-
-  std::string f_code = read_file(fragment_path);
-  if (f_code == "") return -1;
-  std::cout << fragment_path << " SUCCESSFULLY READ" << std::endl;
-
-  const char *v_shader_code = v_code.c_str();
-  const char *f_shader_code = f_code.c_str();
-
-  unsigned int vertex, fragment;
-  // vertex shader
-  vertex = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertex, 1, &v_shader_code, NULL);
-  glCompileShader(vertex);
-  checkCompileErrors(vertex, "VERTEX");
-  // fragment Shader
-  fragment = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragment, 1, &f_shader_code, NULL);
-  glCompileShader(fragment);
-  checkCompileErrors(fragment, "FRAGMENT");
-
-  // shader Program
-  unsigned int program_id = glCreateProgram();
-  glAttachShader(program_id, vertex);
-  glAttachShader(program_id, fragment);
-  glLinkProgram(program_id);
-  checkCompileErrors(program_id, "PROGRAM");
-  // delete the shaders as they're linked into our program now and no longer
-  // necessery
-  glDeleteShader(vertex);
-  glDeleteShader(fragment);
-
-  return program_id;
+UniformBuffer::UniformBuffer(size_t bytes, unsigned int binding) : binding_(binding) {
+  glGenBuffers(1, &buffer_);
+  glBindBuffer(GL_UNIFORM_BUFFER, buffer_);
+  glBufferData(GL_UNIFORM_BUFFER, bytes, NULL, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformBuffer::~UniformBuffer() { glDeleteBuffers(1, &buffer_); }
+
+void UniformBuffer::update(const void *data, size_t bytes) {
+  glBindBuffer(GL_UNIFORM_BUFFER, buffer_);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, bytes, data);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glBindBufferBase(GL_UNIFORM_BUFFER, binding_, buffer_);
 }
@@ -1,7 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * directory where linked programs are saved by GL 4.1 drivers and loaded back on the next runs,
+ * skipping compilation and linking when the sources and the driver are the same
+ * empty disables the cache, nothing is cached until the caller picks a directory (the app uses shader_cache,
+ * see --shader-cache)
+ */
+void set_program_cache(const std::string &directory);
+
+/**
+ * shaders are embedded in the executable at build time (cmake/EmbedShaders.cmake)
+ * a directory makes them read from its files instead, to try edits without rebuilding
+ * empty goes back to the embedded ones
+ */
+void set_shader_directory(const std::string &directory);
+
+// name and value of #define lines put right after the #version line of every shader of a program
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * shaders of a program, files of shaders/ typed by their extension (.vs, .fs, .comp), and the defines
+ * specializing them, #include "file" lines of the shaders are replaced by the file
+ */
+struct ProgramSpec {
+  std::vector<std::string> shaders;
+  ShaderDefines defines;
+};
+bool operator==(const ProgramSpec &a, const ProgramSpec &b);
+
+/**
+ * issues the compilation and link of every program before asking the driver about any of them,
+ * so it can work on all at once
+ * the ShaderProgram built later from the same spec takes its program instead of compiling it again
+ */
+void compile_programs(const std::vector<ProgramSpec> &programs);
+// deletes the programs of compile_programs no ShaderProgram took, once every program of the run is built
+void discard_pending_programs();
+
+/**
+ * lets a driver with GL_KHR_parallel_shader_compile use its own threads, takes glMaxShaderCompilerThreadsKHR
+ * (or the ARB one), null leaves the driver as it is
+ */
+void enable_parallel_compile(void *max_shader_compiler_threads);
+
+// programs created so far and how long it took
+struct ProgramStats {
+  int cached = 0;
+  int compiled = 0;
+  double seconds = 0;
+};
+ProgramStats program_stats();
 
 /**
- * reads shaders from files and return shader program's id
- * returns 1 if there was an error during creation
- * will print error in console
+ * linked program, deleted with the object
+ * every active uniform and uniform block is looked up once at link time
+ * compile and link errors are printed in console and leave the program invalid
  */
-int create_shader_program(const char *vertexPath, const char *fragmentPath);
\ No newline at end of file
+class ShaderProgram {
+ public:
+  ShaderProgram() = default;
+  // compiles and links the shaders, a compute shader needs a GL 4.3 context
+  explicit ShaderProgram(const ProgramSpec &spec);
+  ShaderProgram(ShaderProgram &&other) noexcept;
+  ShaderProgram &operator=(ShaderProgram other) noexcept;
+  ~ShaderProgram();
+
+  bool valid() const { return id_ != 0; }
+  unsigned int id() const { return id_; }
+  void use() const;
+
+  // location of an active uniform, -1 for one the program doesn't use
+  int uniform(const std::string &name) const;
+
+  // setters of the default block uniforms, the program has to be in use
+  // unused uniforms are ignored like glUniform does with -1
+  void set(const std::string &name, int value) const;
+  void set(const std::string &name, int x, int y) const;
+  void set(const std::string &name, float x, float y) const;
+  void set_vec4(const std::string &name, const float *value) const;
+
+  // reads a uniform block from the buffer bound to binding (see UniformBuffer), false if the program has no such block
+  bool bind_block(const std::string &name, unsigned int binding) const;
+
+  /**
+   * builds the program again when one of its shaders or of the files they include is among the changed names
+   * (see ShaderWatcher)
+   * the new program replaces this one only if it compiles and links, the previous one is kept otherwise
+   * true when replaced, its uniforms and block bindings are back to their defaults and have to be set again
+   */
+  bool reload(const std::vector<std::string> &changed);
+
+  void swap(ShaderProgram &other) noexcept;
+
+ private:
+  void build();
+  void find_uniforms();
+
+  unsigned int id_ = 0;
+  // what the program was built from, for reload
+  ProgramSpec spec_;
+  // shaders and the files they include
+  std::vector<std::string> files_;
+  std::unordered_map<std::string, int> uniforms_;
+  std::unordered_map<std::string, unsigned int> blocks_;
+};
+
+/**
+ * watches a shader directory (see set_shader_directory) for files written or moved in
+ * needs inotify, elsewhere than on Linux nothing is ever reported
+ */
+class ShaderWatcher {
+ public:
+  explicit ShaderWatcher(const std::string &directory);
+  ~ShaderWatcher();
+  ShaderWatcher(const ShaderWatcher &) = delete;
+  ShaderWatcher &operator=(const ShaderWatcher &) = delete;
+
+  // names of the files changed since the last call, without waiting
+  std::vector<std::string> changed();
+
+ private:
+  int fd_ = -1;
+};
+
+/**
+ * uniform block data shared by programs, updated once per frame instead of setting uniforms one by one
+ * the layout of the struct written has to match the std140 block
+ */
+class UniformBuffer {
+ public:
+  // needs a current GL context
+  UniformBuffer(size_t bytes, unsigned int binding);
+  ~UniformBuffer();
+  UniformBuffer(const UniformBuffer &) = delete;
+  UniformBuffer &operator=(const UniformBuffer &) = delete;
+
+  // replaces the content and binds the buffer to its binding point
+  void update(const void *data, size_t bytes);
+
+ private:
+  unsigned int buffer_ = 0;
+  unsigned int binding_;
+};
@@ -0,0 +1,68 @@
+#include "soup.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+uint64_t splitmix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+
+uint64_t soup_word(uint64_t seed, double density, uint64_t row, uint64_t word) {
+  const int level = (int)std::lround(std::min(std::max(density, 0.0), 1.0) * 256);
+  if (level == 0) return 0;
+  if (level == 256) return ~uint64_t(0);
+
+  const uint64_t key = splitmix64(splitmix64(seed ^ splitmix64(row)) + word);
+  // combine one random word per bit of level, from the least significant one:
+  // or-ing with a fair word maps probability p to (1 + p) / 2 and and-ing maps it to p / 2
+  // so the result ends up alive with probability level / 256
+  int bit = 0;
+  while (((level >> bit) & 1) == 0) bit++;
+  uint64_t cells = 0;
+  for (; bit < 8; bit++) {
+    const uint64_t r = splitmix64(key + bit);
+    if ((level >> bit) & 1)
+      cells |= r;
+    else
+      cells &= r;
+  }
+  return cells;
+}
+
+void fill_random_rows(Board &board, uint64_t seed, double density, int row_begin, int row_end) {
+  const uint64_t mask = last_word_mask(board.width);
+  for (int y = row_begin; y < row_end; y++) {
+    uint64_t *row = board.cells.data() + (size_t)y * board.stride;
+    for (int i = 0; i < board.stride; i++) row[i] = soup_word(seed, density, y, i);
+    row[board.stride - 1] &= mask;
+  }
+  mark_rows_changed(board, row_begin, row_end);
+}
+
+void fill_random(Board &board, uint64_t seed, double density, int threads) {
+  if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = std::min(threads, std::max(board.height, 1));
+
+  // on a row of tiles, the threads flag the tiles of their rows
+  auto split = [&](int t) { return t == threads ? board.height : board.height * t / threads / tile_rows * tile_rows; };
+  std::vector<std::thread> workers;
+  for (int t = 1; t < threads; t++)
+    workers.emplace_back(fill_random_rows, std::ref(board), seed, density, split(t), split(t + 1));
+  fill_random_rows(board, seed, density, 0, split(1));
+  for (auto &worker : workers) worker.join();
+}
+
+void fill_soup(Board &board, uint64_t seed, double density, int x, int y, int width, int height) {
+  for (int row = 0; row < height; row++) {
+    for (int i = 0; i * 64 < width; i++) {
+      const uint64_t cells = soup_word(seed, density, row, i);
+      const int count = std::min(64, width - i * 64);
+      for (int bit = 0; bit < count; bit++) set_cell(board, x + i * 64 + bit, y + row, (cells >> bit) & 1);
+    }
+  }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+#include "life.hpp"
+
+/**
+ * random soups from a counter based generator
+ * every word of cells only depends on (seed, density, row, word index) so any region
+ * can be generated on its own, in any order, by any number of threads
+ * and still give the same board for a given seed
+ */
+
+uint64_t splitmix64(uint64_t x);
+
+/**
+ * 64 cells, each alive with probability `density`
+ * density is rounded to the nearest 1/256
+ */
+uint64_t soup_word(uint64_t seed, double density, uint64_t row, uint64_t word);
+
+// fills rows [row_begin, row_end) of the whole board width, concurrent fills must not share a row of tiles
+void fill_random_rows(Board &board, uint64_t seed, double density, int row_begin, int row_end);
+
+// fills the whole board, splitting rows between `threads` threads (0 = one per core)
+void fill_random(Board &board, uint64_t seed, double density, int threads = 0);
+
+/**
+ * fills the rectangle at (x, y) of size width * height, everything else is left untouched
+ * cells are keyed relative to the rectangle so the same seed gives the same soup wherever it's placed
+ */
+void fill_soup(Board &board, uint64_t seed, double density, int x, int y, int width, int height);
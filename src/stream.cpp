@@ -0,0 +1,71 @@
+#include "stream.hpp"
+
+namespace {
+
+constexpr GLbitfield persistent_flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+}  // namespace
+
+StreamBuffer::StreamBuffer(GLenum target, size_t segment_bytes, int segments)
+    : target_(target), segment_bytes_((segment_bytes + 255) / 256 * 256), segments_(segments), fences_(segments) {
+  glGenBuffers(1, &buffer_);
+  glBindBuffer(target_, buffer_);
+  if (GLAD_GL_VERSION_4_4) {
+    glBufferStorage(target_, segment_bytes_ * segments_, NULL, persistent_flags);
+    mapping_ = (unsigned char *)glMapBufferRange(target_, 0, segment_bytes_ * segments_, persistent_flags);
+  }
+  if (mapping_ == nullptr) {
+    // GL 3.3, or the persistent mapping failed: a single segment orphaned on every map
+    segments_ = 1;
+    glBufferData(target_, segment_bytes_, NULL, GL_STREAM_DRAW);
+  }
+  glBindBuffer(target_, 0);
+}
+
+StreamBuffer::~StreamBuffer() {
+  for (GLsync fence : fences_)
+    if (fence != nullptr) glDeleteSync(fence);
+  if (mapping_ != nullptr) {
+    glBindBuffer(target_, buffer_);
+    glUnmapBuffer(target_);
+    glBindBuffer(target_, 0);
+  }
+  glDeleteBuffers(1, &buffer_);
+}
+
+unsigned char *StreamBuffer::map() {
+  if (mapping_ == nullptr) {
+    glBindBuffer(target_, buffer_);
+    glBufferData(target_, segment_bytes_, NULL, GL_STREAM_DRAW);
+    unsigned char *segment =
+        (unsigned char *)glMapBufferRange(target_, 0, segment_bytes_, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    glBindBuffer(target_, 0);
+    return segment;
+  }
+
+  current_ = (current_ + 1) % segments_;
+  GLsync &fence = fences_[current_];
+  if (fence != nullptr) {
+    // waiting has to flush, otherwise the fence may never reach the GPU
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+  return mapping_ + current_ * segment_bytes_;
+}
+
+size_t StreamBuffer::unmap() {
+  if (mapping_ == nullptr) {
+    glBindBuffer(target_, buffer_);
+    glUnmapBuffer(target_);
+    glBindBuffer(target_, 0);
+  }
+  // coherent mapping, the writes are visible to commands issued from now on
+  return current_ * segment_bytes_;
+}
+
+void StreamBuffer::fence() {
+  if (mapping_ == nullptr) return;
+  fences_[current_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * ring of buffer segments the CPU writes into while the GPU reads the previous ones
+ * with GL 4.4 the whole ring is mapped once, persistent and coherent, and a fence per segment
+ * tells when it can be written again, so cells are written straight into memory the GPU reads
+ * on older contexts every map orphans a single segment, letting the driver hand out fresh memory
+ */
+class StreamBuffer {
+ public:
+  // needs a current GL context, target is where the buffer is read from (GL_ARRAY_BUFFER, GL_PIXEL_UNPACK_BUFFER, ...)
+  StreamBuffer(GLenum target, size_t segment_bytes, int segments = 3);
+  ~StreamBuffer();
+  StreamBuffer(const StreamBuffer &) = delete;
+  StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+  // next segment to write, waits for the GPU when it is still reading it
+  unsigned char *map();
+  // ends the writes, returns the offset of the segment in buffer()
+  size_t unmap();
+  // to call once the commands reading the segment are issued
+  void fence();
+
+  GLuint buffer() const { return buffer_; }
+  bool persistent() const { return mapping_ != nullptr; }
+
+ private:
+  GLenum target_;
+  GLuint buffer_ = 0;
+  size_t segment_bytes_;
+  int segments_;
+  int current_ = 0;
+  unsigned char *mapping_ = nullptr;
+  std::vector<GLsync> fences_;
+};
@@ -0,0 +1,67 @@
+#include "timing.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX 1
+#endif
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+double process_cpu_seconds() {
+#ifdef _WIN32
+  FILETIME creation, exit, kernel, user;
+  if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) return 0;
+  // 100 ns units
+  const auto seconds = [](const FILETIME &time) {
+    return ((unsigned long long)time.dwHighDateTime << 32 | time.dwLowDateTime) * 1e-7;
+  };
+  return seconds(kernel) + seconds(user);
+#else
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+#endif
+}
+
+GenerationClock::GenerationClock(double rate) { set_rate(rate); }
+
+void GenerationClock::set_rate(double rate) { rate_ = std::min(std::max(rate, min_rate), max_rate); }
+
+int GenerationClock::advance(double now, int max_generations) {
+  if (now > last_) {
+    backlog_ += (now - last_) * rate_;
+    requested_ += (now - last_) * rate_;
+  }
+  last_ = now;
+  const double whole = std::floor(backlog_);
+  backlog_ -= whole;
+  const double limit = std::max(1.0, std::min(std::floor(rate_ * max_catch_up), (double)max_generations));
+  if (whole <= limit) return (int)whole;
+  dropped_ += (long long)(whole - limit);
+  return (int)limit;
+}
+
+void GenerationClock::restart(double now) {
+  last_ = now;
+  backlog_ = 0;
+}
+
+double GenerationClock::until_next(double now) const {
+  return std::max((1 - backlog_) / rate_ - (now - last_), 0.0);
+}
+
+int FrameBudget::batch() const {
+  if (cost_ <= 0) return 1;
+  return (int)std::min(std::max(seconds_ / cost_, 1.0), (double)max_batch);
+}
+
+void FrameBudget::record(int generations, double seconds) {
+  if (generations <= 0) return;
+  const double cost = seconds / generations;
+  cost_ = cost_ <= 0 ? cost : cost_ * .75 + cost * .25;
+}
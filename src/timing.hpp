@@ -0,0 +1,67 @@
+#pragma once
+
+// cpu time used by the process so far, user and system, all threads together
+double process_cpu_seconds();
+
+/**
+ * schedule of the generations at a fixed rate, independent of the frame rate
+ * elapsed time accumulates and each advance takes the whole generations it covers, so a frame can run many
+ * or none, keeping the fraction for the next one
+ * after a stall at most max_catch_up seconds of generations run at once and the rest is dropped,
+ * rather than falling further behind with every frame
+ * that caps generations, not the time they take, so callers also pass what fits in a frame (see FrameBudget)
+ */
+class GenerationClock {
+ public:
+  static constexpr double min_rate = 0.1;
+  static constexpr double max_rate = 100000;
+  static constexpr double max_catch_up = 0.25;
+
+  // generations per second, clamped to [min_rate, max_rate]
+  explicit GenerationClock(double rate);
+  void set_rate(double rate);
+  double rate() const { return rate_; }
+
+  // generations due at time now, in seconds, at most max_generations, the ones past it are dropped
+  int advance(double now, int max_generations);
+  // starts counting from now, as when resuming after a pause
+  void restart(double now);
+  // seconds from now until the next generation is due
+  double until_next(double now) const;
+
+  // generations the elapsed time asked for so far, and the ones skipped by the catch-up and frame limits
+  double requested() const { return requested_; }
+  long long dropped() const { return dropped_; }
+
+ private:
+  double rate_;
+  double last_ = 0;
+  // generations accumulated and not run yet, less than one after each advance
+  double backlog_ = 0;
+  double requested_ = 0;
+  long long dropped_ = 0;
+};
+
+/**
+ * generations fitting in a slice of each frame, sized from the measured cost of the previous batches
+ * the cost per generation is a moving average, a single slow batch (a page fault, a busy core) only
+ * shrinks the next ones a little
+ */
+class FrameBudget {
+ public:
+  static constexpr int max_batch = 1 << 20;
+
+  explicit FrameBudget(double seconds) : seconds_(seconds) {}
+  void set_seconds(double seconds) { seconds_ = seconds; }
+  double seconds() const { return seconds_; }
+
+  // generations to run this frame, one until a batch was measured
+  int batch() const;
+  // time the batch of generations took
+  void record(int generations, double seconds);
+  double seconds_per_generation() const { return cost_; }
+
+ private:
+  double seconds_;
+  double cost_ = 0;
+};